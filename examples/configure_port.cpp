@@ -35,12 +35,11 @@ int main(const int argc, char *argv[]) try {
   // Unlike libserialport, there is one way to configure the port.
   // TODO
 
-  auto conn = sp::connection{port,
-                             sp::mode_t::ReadWrite,
-                             {.baud_rate = 115200,
-                              .bits = 8,
-                              .stop_bits = 1,
-                              .parity = sp::parity_t::None}};
+  // Settings that are known at compile time can be given as a static
+  // configuration, which is validated by the compiler.
+  auto conn = sp::connection{
+      port, sp::mode_t::ReadWrite,
+      sp::static_config<115200, 8, sp::parity_t::None, 1>{}};
 
   const auto initial_config = conn.get_config();
 
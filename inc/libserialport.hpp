@@ -3,9 +3,13 @@
 #ifndef LIBSERIALPORT_HPP_INCLUDED
 #define LIBSERIALPORT_HPP_INCLUDED
 
+#include <chrono>
 #include <cstdint>
 #include <exception>
 #include <memory>
+#include <memory_resource>
+#include <span>
+#include <utility>
 #include <vector>
 
 extern "C" struct sp_port;
@@ -57,7 +61,7 @@ namespace sp {
     return lhs.vid == rhs.vid && lhs.pid == rhs.pid;
   }
 
-  // gets the status of the most recent call
+  // gets the status of the most recent call on the calling thread
   status_t get_status() noexcept;
 
   // gets the error message for the most recent call
@@ -72,6 +76,28 @@ namespace sp {
   // if no ports are available, or there is an error, an empty list is returned
   std::vector<port_t> list_ports();
 
+  // as above, but allocates the list, and the bookkeeping of the ports, from
+  // `resource`
+  std::pmr::vector<port_t> list_ports(std::pmr::memory_resource *resource);
+
+  // how much is found out about ports as they are listed
+  enum class metadata_t : std::uint8_t {
+    Eager, // everything, which includes reading the descriptors of USB devices
+    Lazy   // only names and transports, anything else on first access
+  };
+
+  // get a list of available ports, with their metadata as requested
+  // on Linux, ports are listed lazily by scanning `sysfs_root` like
+  // libserialport does, elsewhere, or if `sysfs_root` cannot be scanned,
+  // `list_ports()` is used
+  std::vector<port_t> list_ports(metadata_t metadata,
+                                 const char *sysfs_root = "/sys");
+
+  // fetches the metadata of a port that has been listed lazily, which the
+  // accessors below do on first access
+  // other ports, or ports that have been fetched before, are left alone
+  status_t fetch_metadata(const port_t &p) noexcept;
+
   // get the name of the given port (e.g. `COM1` or `/dev/ttyUSB0`)
   // for an invalid port, the empty string is returned
   // if valid, the return value points into the port structure
@@ -118,6 +144,24 @@ namespace sp {
   // the handle will be written into the memory pointed to by `result_ptr`
   status_t get_native_handle(const port_t &p, void *result_ptr);
 
+  // sets the latency timer of the FTDI adapter behind the named port via the
+  // `latency_timer` attribute of the ftdi_sio driver below `sysfs_root`
+  // returns `NotSupported` if the port has no such attribute
+  status_t set_ftdi_latency_timer(const char *port_name, int latency_timer_ms,
+                                  const char *sysfs_root = "/sys");
+
+  // gets the latency timer of the FTDI adapter behind the named port
+  // returns `-1` if the port has no latency timer, or on error
+  int get_ftdi_latency_timer(const char *port_name,
+                             const char *sysfs_root = "/sys");
+
+  // what `connection::set_low_latency` was able to apply
+  struct low_latency_t {
+    status_t async_low_latency; // the `ASYNC_LOW_LATENCY` serial flag
+    status_t latency_timer;     // the latency timer of FTDI adapters
+    int latency_timer_ms;       // now in effect, or `-1` if there is none
+  };
+
   class connection_exc final : public std::exception {
    public:
     explicit connection_exc(std::shared_ptr<const char> cause)
@@ -138,9 +182,156 @@ namespace sp {
     parity_t parity{parity_t::Invalid};
   };
 
+  // flags for the settings of a `port_config_t` that are not left alone
+  enum class config_field_t : std::uint8_t {
+    None = 0U,
+    BaudRate = 1U,
+    Bits = 2U,
+    StopBits = 4U,
+    Parity = 8U,
+    All = 15U
+  };
+
+  constexpr config_field_t operator|(const config_field_t lhs,
+                                     const config_field_t rhs) {
+    return static_cast<config_field_t>(static_cast<std::uint8_t>(lhs)
+                                       | static_cast<std::uint8_t>(rhs));
+  }
+
+  // returns the settings of the given configuration that are not left alone
+  constexpr config_field_t fields_of(const port_config_t &cfg) {
+    return (cfg.baud_rate != -1 ? config_field_t::BaudRate
+                                : config_field_t::None)
+           | (cfg.bits != -1 ? config_field_t::Bits : config_field_t::None)
+           | (cfg.stop_bits != -1 ? config_field_t::StopBits
+                                  : config_field_t::None)
+           | (cfg.parity != parity_t::Invalid ? config_field_t::Parity
+                                              : config_field_t::None);
+  }
+
+  // returns the time it takes to transfer a single character, i.e. start, data,
+  // parity and stop bits, in microseconds (rounded up)
+  // if the baud rate or framing is not known, `-1` is returned
+  constexpr long character_time_us(const port_config_t &cfg) {
+    if (cfg.baud_rate <= 0 || cfg.bits <= 0 || cfg.stop_bits <= 0
+        || cfg.parity == parity_t::Invalid) {
+      return -1;
+    }
+    const auto bits = 1L + cfg.bits + (cfg.parity != parity_t::None ? 1L : 0L)
+                      + cfg.stop_bits;
+    return (bits * 1'000'000L + cfg.baud_rate - 1L) / cfg.baud_rate;
+  }
+
+  // returns the relative deviation of the actual from the requested baud rate
+  constexpr double baud_rate_error(const int requested, const int actual) {
+    return requested > 0 ? static_cast<double>(actual - requested) / requested
+                         : 0.0;
+  }
+
+  // a run of bytes that became available at once
+  struct rx_chunk_t {
+    int offset; // into the buffer that was read into
+    int length;
+    std::chrono::steady_clock::time_point timestamp; // of becoming available
+    // the bytes were already waiting when the read started, so they may have
+    // arrived well before `timestamp`
+    bool backlogged;
+  };
+
+  // estimates when byte `index` of `chunk` arrived, assuming that the bytes of
+  // the chunk were received back-to-back, up until its timestamp
+  // see `character_time_us` for the time per byte
+  constexpr std::chrono::steady_clock::time_point
+  byte_arrival(const rx_chunk_t &chunk, const int index,
+               const long character_time_us) {
+    if (character_time_us <= 0) {
+      return chunk.timestamp;
+    }
+    return chunk.timestamp
+           - std::chrono::microseconds{(chunk.length - 1L - index)
+                                       * character_time_us};
+  }
+
+  enum class line_error_t : std::uint8_t {
+    Break,
+    Framing,
+    Parity,
+    ParityOrFraming, // the driver did not tell which
+    Overrun
+  };
+
+  struct line_event_t {
+    int position; // in the data read, of the affected byte or the one after
+    line_error_t error;
+  };
+
+  // counters of line errors as maintained by the driver, `-1` where unknown
+  struct line_error_counts_t {
+    long breaks{-1};
+    long framing{-1};
+    long parity{-1};
+    long overrun{-1};        // in the hardware
+    long buffer_overrun{-1}; // in the driver
+  };
+
+  // removes the marks that the driver inserts in the data with PARMRK, i.e.
+  // `\377 \377` for a byte `\377`, `\377 \0 c` for a byte `c` that was received
+  // with a parity or framing error, and `\377 \0 \0` for a break
+  // bytes received with errors are kept, whereas breaks leave no byte
+  // marks may be split across reads, so the state is kept between them
+  class parmrk_decoder {
+   public:
+    // decodes `count` bytes of `buf` in place, appending an event to `events`
+    // for every error, returns the number of bytes left
+    int decode(char *buf, int count, std::vector<line_event_t> &events);
+
+    void reset() noexcept;
+
+   private:
+    std::uint8_t state_{0}; // number of bytes of a mark seen so far
+  };
+
+  // sizes of the receive and transmit buffers of a driver in bytes
+  struct buffer_sizes_t {
+    int rx{-1};
+    int tx{-1};
+  };
+
+  // a port configuration that is fixed at compile time
+  // `-1` or `parity_t::Invalid` leave the respective setting alone
+  template <int BaudRate, int Bits = 8, parity_t Parity = parity_t::None,
+            int StopBits = 1>
+  struct static_config {
+    static_assert(BaudRate == -1 || BaudRate > 0, "invalid baud rate");
+    static_assert(Bits == -1 || (Bits >= 5 && Bits <= 8),
+                  "invalid number of data bits");
+    static_assert(Parity >= parity_t::Invalid && Parity <= parity_t::Space,
+                  "invalid parity");
+    static_assert(StopBits == -1 || StopBits == 1 || StopBits == 2,
+                  "invalid number of stop bits");
+
+    static constexpr auto value = port_config_t{.baud_rate = BaudRate,
+                                                .bits = Bits,
+                                                .stop_bits = StopBits,
+                                                .parity = Parity};
+    static constexpr auto fields = fields_of(value);
+
+    constexpr operator port_config_t() const { // NOLINT(*-explicit-*)
+      return value;
+    }
+  };
+
   class connection {
    public:
     connection(port_t p, mode_t m, const port_config_t &cfg = {});
+
+    template <int BaudRate, int Bits, parity_t Parity, int StopBits>
+    connection(port_t p, const mode_t m,
+               const static_config<BaudRate, Bits, Parity, StopBits> cfg)
+        : connection{std::move(p), m} {
+      set_config(cfg);
+    }
+
     ~connection();
 
     connection(const connection &) = delete;
@@ -149,9 +340,22 @@ namespace sp {
     connection(connection &&) = default;
     connection &operator=(connection &&) = default;
 
+    // returns the port this connection has been opened on
+    const port_t &get_port() const noexcept;
+
     port_config_t get_config() const;
     status_t set_config(const port_config_t &cfg);
 
+    // applies only the settings that are not left alone, decided at compile
+    // time
+    template <int BaudRate, int Bits, parity_t Parity, int StopBits>
+    status_t
+    set_config([[maybe_unused]] const static_config<BaudRate, Bits, Parity,
+                                                    StopBits> cfg) {
+      using cfg_t = static_config<BaudRate, Bits, Parity, StopBits>;
+      return apply_config<cfg_t::fields>(cfg_t::value);
+    }
+
     // blocks until `count` bytes are available, or the timeout has expired
     // returns the number of bytes read, or -1 on error
     int read_blocking(void *buf, int count, long timeout_ms);
@@ -163,6 +367,30 @@ namespace sp {
     // returns the number of bytes read, or -1 on error
     int read_nonblocking(void *buf, int count);
 
+    // reads all bytes that are waiting in a single call, or else blocks until
+    // any data is available or the timeout has expired
+    // afterwards, waits for as many further bytes as the baud rate allows to
+    // arrive within `latency_budget_ms`, so that bursts are read in one go,
+    // but returns early once the line has been idle for a few characters
+    // returns the number of bytes read, or -1 on error
+    int read_adaptive(void *buf, int count, long timeout_ms,
+                      long latency_budget_ms);
+
+    // reads like `read_blocking`, but takes a timestamp as soon as the port
+    // becomes readable, appending an entry to `chunks` for every run of bytes
+    // that became available at once
+    // returns the number of bytes read, or -1 on error
+    int read_timestamped(void *buf, int count, long timeout_ms,
+                         std::vector<rx_chunk_t> &chunks);
+
+    // scatter reads, which fill the buffers in order as if they were one,
+    // but otherwise behave like their counterparts above
+    int read_blocking(std::span<const std::span<std::byte>> bufs,
+                      long timeout_ms);
+    int read_next_blocking(std::span<const std::span<std::byte>> bufs,
+                           long timeout_ms);
+    int read_nonblocking(std::span<const std::span<std::byte>> bufs);
+
     // returns the number of bytes waiting in the input buffer
     int input_waiting();
 
@@ -176,6 +404,51 @@ namespace sp {
     // returns the number of bytes waiting in the output buffer
     int output_waiting();
 
+    // gets the baud rate the driver reports to be in effect
+    // non-standard rates are requested through `BOTHER` on Linux, which drivers
+    // may round to what the hardware is capable of
+    // returns -1 on error
+    int get_actual_baud_rate();
+
+    // sets the sizes of the buffers of the driver
+    // returns `NotSupported` where the driver does not allow it, e.g. on Linux
+    status_t set_buffer_sizes(const buffer_sizes_t &sizes);
+
+    // gets the sizes of the buffers of the driver, `-1`s where unknown
+    // the status is `NotSupported` where the driver does not tell them, e.g.
+    // on Linux
+    buffer_sizes_t get_buffer_sizes();
+
+    // makes the driver hand over received data as soon as possible, or
+    // restores the settings that enabling it has changed if `enable` is false,
+    // leaving those alone that it has not changed
+    // on Linux, the `ASYNC_LOW_LATENCY` flag is set and the latency timer of
+    // FTDI adapters, which defaults to 16 ms, is set to `latency_timer_ms`
+    // settings that are not available are reported as `NotSupported`, the
+    // status is `OK` if any setting could be applied
+    low_latency_t set_low_latency(bool enable, int latency_timer_ms = 1);
+
+    // makes the driver mark bytes that were received with errors, as well as
+    // breaks, in the data, which `read_marked` reports
+    // on Linux, `PARMRK` is set and breaks and parity errors are no longer
+    // ignored, which `set_config` keeps to while marking is enabled
+    // disabling it restores the input flags that enabling it has changed
+    status_t set_error_marking(bool enable);
+
+    // reads like `read_next_blocking` with error marking enabled, removing the
+    // marks from the data and appending an event per error to `events`
+    // parity and framing errors are told apart by the counters of the driver,
+    // where available, and overruns are reported at the end of the data
+    // returns the number of bytes read, or -1 on error
+    int read_marked(void *buf, int count, long timeout_ms,
+                    std::vector<line_event_t> &events);
+
+    // holds the line in the break condition for the given duration
+    status_t send_break(int duration_ms);
+
+    // gets the counters of line errors since the port was opened
+    line_error_counts_t get_error_counts();
+
     // discards any data in the rx & tx buffers
     status_t flush(buffer_t buffers_to_flush);
 
@@ -183,7 +456,27 @@ namespace sp {
     status_t drain();
 
    private:
+    // instantiated for all combinations of fields in the implementation
+    template <config_field_t Fields>
+    status_t apply_config(const port_config_t &cfg);
+
+    // sets the flags of the driver that `set_error_marking` is about, saving
+    // those that were in effect when enabling and restoring them on disabling
+    // `adopt_parity` takes over whether parity errors are ignored from what
+    // `set_config` has set, as the setting to restore
+    status_t apply_error_marking(bool enable, bool adopt_parity = false);
+
+    int read_scatter(std::span<const std::span<std::byte>> bufs,
+                     long timeout_ms, bool blocking, bool until_full);
+
     port_t p_;
+    long character_time_us_{0}; // `0` until it is needed
+    int saved_latency_timer_ms_{-1}; // while the low-latency mode is enabled
+    bool set_async_low_latency_{false}; // by `set_low_latency`
+    parmrk_decoder parmrk_;
+    bool error_marking_{false};
+    unsigned long saved_iflag_{0}; // as of before error marking was enabled
+    line_error_counts_t error_counts_; // as of the last `read_marked`
   };
 
 } // namespace sp
@@ -0,0 +1,76 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Detects the baud rate and framing of a port from the traffic on it.
+
+#ifndef SPP_AUTODETECT_HPP_INCLUDED
+#define SPP_AUTODETECT_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <cstddef>
+#include <functional>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  // returns the share of `data` that is printable ASCII, including tabs and
+  // line breaks, from `0` to `1`
+  double score_text(std::span<const std::byte> data) noexcept;
+
+  struct autodetect_options_t {
+    // candidates are tried by baud rate, then by framing, in the given order,
+    // so the most likely ones should come first
+    std::vector<int> baud_rates{115'200, 9'600,  57'600, 38'400,
+                                19'200,  230'400, 4'800, 2'400,
+                                1'200,   460'800, 921'600};
+    // the baud rates of these are ignored
+    std::vector<port_config_t> framings{
+        {.bits = 8, .stop_bits = 1, .parity = parity_t::None},
+        {.bits = 7, .stop_bits = 1, .parity = parity_t::Even},
+        {.bits = 8, .stop_bits = 1, .parity = parity_t::Even},
+        {.bits = 7, .stop_bits = 1, .parity = parity_t::Odd},
+        {.bits = 8, .stop_bits = 1, .parity = parity_t::Odd}};
+    // how long a candidate is listened to at most
+    long sample_ms{250};
+    // a candidate is scored as soon as this many bytes have been received
+    std::size_t sample_bytes{256U};
+    // samples that are smaller than this do not end the sweep early
+    std::size_t min_bytes{32U};
+    // a candidate that scores at least this ends the sweep
+    double confident_score{0.98};
+    // rates the content of a sample from `0` to `1`, e.g. by whether it
+    // parses as the protocol expected, or not at all if empty
+    std::function<double(std::span<const std::byte>)> content_score{
+        score_text};
+    // called once a candidate is in effect, before it is sampled, e.g. to
+    // send a request to devices that only talk when asked
+    std::function<void(connection &, const port_config_t &)> probe{};
+  };
+
+  struct autodetect_result_t {
+    status_t status{status_t::OK};
+    port_config_t config{}; // that scored best, and which is left in effect
+    double score{0.0};      // from `0` to `1`, `0` if nothing was received
+    int candidates{0};      // number of candidates sampled
+  };
+
+  // sweeps the candidates of `options` on `conn`, scoring what is received
+  // with each by its rate of framing and parity errors as well as by its
+  // content, and stops early on a candidate that scores confidently
+  // if nothing is received at all, the configuration is left as it was
+  // error marking is disabled afterwards
+  autodetect_result_t autodetect(connection &conn,
+                                 const autodetect_options_t &options = {});
+
+  // detects the settings of all connections concurrently, on up to
+  // `max_workers` threads, since sweeping mostly waits for data
+  // results are in the order of `conns`
+  std::vector<autodetect_result_t>
+  autodetect(std::span<connection> conns,
+             const autodetect_options_t &options = {},
+             unsigned max_workers = 16U);
+
+} // namespace sp
+
+#endif // SPP_AUTODETECT_HPP_INCLUDED
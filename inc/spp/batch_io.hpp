@@ -0,0 +1,88 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Submits reads and writes on many connections at once.
+
+#ifndef SPP_BATCH_IO_HPP_INCLUDED
+#define SPP_BATCH_IO_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  struct completion_t {
+    std::uint64_t user_data; // as passed when queueing the operation
+    int result;              // bytes transferred, or -1 on error
+    status_t status;
+  };
+
+  // queues reads and writes on any number of connections and reports them as
+  // they complete
+  // with `SP_WITH_IO_URING` on Linux, all operations are submitted through a
+  // single io_uring; if that is disabled or unavailable, operations are waited
+  // for with libserialport's event sets and carried out one after another
+  // buffers must stay valid until the respective operation has completed
+  class batch_io {
+   public:
+    // `depth` is the maximum number of operations in flight at once
+    // the queue of operations is allocated from `resource` up front, so that
+    // queueing does not allocate
+    explicit batch_io(unsigned depth = 256U, bool use_io_uring = true,
+                      std::pmr::memory_resource *resource =
+                          std::pmr::get_default_resource());
+    ~batch_io();
+
+    batch_io(const batch_io &) = delete;
+    batch_io &operator=(const batch_io &) = delete;
+
+    batch_io(batch_io &&) = delete;
+    batch_io &operator=(batch_io &&) = delete;
+
+    // returns whether operations are submitted through io_uring
+    bool is_accelerated() const noexcept;
+
+    // registers buffers with the kernel, which saves mapping them on every
+    // operation on a buffer that lies within one of these
+    // returns `NotSupported` if not accelerated
+    status_t register_buffers(std::span<const std::span<std::byte>> buffers);
+
+    // queues a read of any data that arrives, up to the size of `buf`
+    // returns `NotSupported` if accelerated and the port has no native handle
+    status_t read(connection &conn, std::span<std::byte> buf,
+                  std::uint64_t user_data);
+
+    // queues a write of (at least a part of) `buf`
+    // returns `NotSupported` if accelerated and the port has no native handle
+    status_t write(connection &conn, std::span<const std::byte> buf,
+                   std::uint64_t user_data);
+
+    // returns the number of operations queued or in flight
+    std::size_t pending() const noexcept;
+
+    // submits all queued operations and blocks until at least one operation
+    // has completed or the timeout has expired, appending all completions to
+    // `completions`
+    // a timeout of `0` waits indefinitely, like `read_blocking` does
+    status_t wait(std::vector<completion_t> &completions, long timeout_ms);
+
+   private:
+    struct operation;
+    struct ring;
+
+    status_t wait_fallback(std::vector<completion_t> &completions,
+                           long timeout_ms);
+
+    unsigned depth_;
+    std::unique_ptr<ring> ring_;
+    std::pmr::vector<operation> queued_;
+  };
+
+} // namespace sp
+
+#endif // SPP_BATCH_IO_HPP_INCLUDED
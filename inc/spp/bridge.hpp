@@ -0,0 +1,75 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Relays data between two connections in both directions.
+
+#ifndef SPP_BRIDGE_HPP_INCLUDED
+#define SPP_BRIDGE_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+namespace sp {
+
+  struct bridge_options_t {
+    // file descriptors that receive a copy of the data relayed in either
+    // direction, e.g. to capture it to a file, `-1` for none
+    // they are made nonblocking, and what they do not take right away is
+    // dropped rather than holding up the bridge
+    int capture_a_to_b{-1};
+    int capture_b_to_a{-1};
+    // moves data through pipes with `splice`, so that it is not copied to
+    // user space, falling back to reading and writing where the kernel does
+    // not support that for the ports
+    bool use_splice{true};
+  };
+
+  struct bridge_stats_t {
+    std::uint64_t a_to_b{0}; // bytes relayed
+    std::uint64_t b_to_a{0};
+    std::uint64_t dropped_a_to_b{0}; // bytes not taken by the capture sink
+    std::uint64_t dropped_b_to_a{0};
+  };
+
+  // relays everything received on one connection to the other, full-duplex,
+  // in a thread of its own
+  // data is taken from a port only once the previous data has been passed
+  // on, so a slow port holds up the direction towards it
+  // on Linux only, elsewhere the bridge reports `NotSupported`
+  class bridge {
+   public:
+    bridge(connection &a, connection &b, const bridge_options_t &options = {});
+    ~bridge();
+
+    bridge(const bridge &) = delete;
+    bridge &operator=(const bridge &) = delete;
+
+    bridge(bridge &&) = delete;
+    bridge &operator=(bridge &&) = delete;
+
+    // returns whether both directions are relayed without copying
+    bool is_zero_copy() const noexcept;
+
+    bridge_stats_t get_stats() const noexcept;
+
+    // returns `OK` while relaying, or else why the bridge has stopped
+    status_t get_status() const noexcept;
+
+   private:
+    struct lane;
+
+    void run(const std::stop_token &stop);
+
+    std::unique_ptr<lane> a_to_b_;
+    std::unique_ptr<lane> b_to_a_;
+    int wakeup_fd_{-1};
+    std::atomic<status_t> status_{status_t::OK};
+    std::jthread relay_; // declared last, so it is stopped first
+  };
+
+} // namespace sp
+
+#endif // SPP_BRIDGE_HPP_INCLUDED
@@ -0,0 +1,34 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Opens and configures many ports at once.
+
+#ifndef SPP_BULK_OPEN_HPP_INCLUDED
+#define SPP_BULK_OPEN_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  struct open_result_t {
+    // empty if the port could not be opened or configured
+    std::optional<connection> conn;
+    status_t status;
+  };
+
+  // opens all ports and applies `cfg` to them concurrently, on up to
+  // `max_workers` threads, so that ports that take long to open, like some
+  // USB adapters do, do not hold up the others
+  // opening mostly waits for the drivers, so more workers than CPUs pay off
+  // a port that fails is reported in its result rather than by throwing
+  // results are in the order of `ports`
+  std::vector<open_result_t> open_all(std::span<const port_t> ports,
+                                      mode_t mode, const port_config_t &cfg = {},
+                                      unsigned max_workers = 16U);
+
+} // namespace sp
+
+#endif // SPP_BULK_OPEN_HPP_INCLUDED
@@ -0,0 +1,96 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Transfers files through XMODEM-1K, YMODEM and ZMODEM.
+
+#ifndef SPP_BULK_TRANSFER_HPP_INCLUDED
+#define SPP_BULK_TRANSFER_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace sp {
+
+  // computes the CRC-16/XMODEM (polynomial 0x1021) piece by piece
+  class crc16 {
+   public:
+    crc16 &update(std::span<const std::byte> data) noexcept;
+
+    std::uint16_t value() const noexcept {
+      return value_;
+    }
+
+   private:
+    std::uint16_t value_{0U};
+  };
+
+  enum class transfer_protocol_t : std::uint8_t {
+    XModem1K, // 1024-byte blocks, CRC-16, stop-and-wait
+    YModem,   // XMODEM-1K with the name and size of the file, as well as
+              // streaming (YMODEM-g) if the receiver asks for it
+    ZModem    // streaming, with recovery from errors and resuming
+  };
+
+  enum class transfer_error_t : std::uint8_t {
+    None,
+    Timeout,       // the other side did not respond
+    Cancelled,     // by the other side
+    TooManyErrors, // retries have been exhausted
+    Protocol,      // the other side does something that is not supported
+    Port,          // reading or writing the port has failed
+    File           // the file to send cannot be read
+  };
+
+  struct transfer_options_t {
+    transfer_protocol_t protocol{transfer_protocol_t::ZModem};
+    // how long to wait for each response of the other side
+    long timeout_ms{10'000};
+    // how often a block is retried, or a request repeated, before giving up
+    int max_retries{10};
+    // YMODEM: receivers ask for streaming without acknowledgements, which
+    // suits error-free links only
+    bool streaming{false};
+    // ZMODEM: senders wait for an acknowledgement once this many bytes are
+    // unacknowledged, `0` streams without waiting
+    std::size_t window{64U * 1'024U};
+    // called with the number of bytes of the file transferred so far
+    std::function<void(std::uint64_t position, std::uint64_t size)>
+        on_progress{};
+  };
+
+  struct transfer_result_t {
+    transfer_error_t error{transfer_error_t::None};
+    std::uint64_t offset{0U}; // at which the transfer started, if resumed
+    std::uint64_t bytes{0U};  // transferred, including any retransmissions
+    std::string name;         // of the file received, YMODEM and ZMODEM only
+  };
+
+  // sends `data` as the file `name`, which XMODEM leaves out
+  // the CRC of a block is computed while the block before it is waited for
+  // with ZMODEM, a receiver that already has a part of the file may ask for
+  // the rest only
+  transfer_result_t send(connection &conn, std::span<const std::byte> data,
+                         const char *name, const transfer_options_t &options);
+
+  // sends the file at `path`, which is mapped into memory rather than read
+  // POSIX only
+  transfer_result_t send_file(connection &conn, const char *path,
+                              const transfer_options_t &options);
+
+  // receives a file into `data`
+  // with ZMODEM, the contents of `data` are taken to be the beginning of the
+  // file, so that a transfer that has been interrupted is resumed
+  // otherwise, `data` is replaced
+  // XMODEM does not convey the size of the file, so the data received is
+  // padded to a multiple of 128 bytes
+  transfer_result_t receive(connection &conn, std::vector<std::byte> &data,
+                            const transfer_options_t &options);
+
+} // namespace sp
+
+#endif // SPP_BULK_TRANSFER_HPP_INCLUDED
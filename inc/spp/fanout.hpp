@@ -0,0 +1,40 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Writes the same data to many connections at once.
+
+#ifndef SPP_FANOUT_HPP_INCLUDED
+#define SPP_FANOUT_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <cstddef>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  // data that is shared by all writes that it is handed to, so that it is
+  // neither copied per port nor freed while still being written
+  using payload_t = std::shared_ptr<const std::vector<std::byte>>;
+
+  payload_t make_payload(std::span<const std::byte> data);
+
+  struct fanout_result_t {
+    int written; // bytes written, less than the payload on timeout or error
+    status_t status;
+  };
+
+  // writes `payload` to all connections concurrently, so that the time taken
+  // is that of the slowest port rather than the sum of all of them
+  // ports are written to whenever they are ready to take data; a port that
+  // fails is left behind without holding up the others
+  // results are in the order of `conns`, a null connection is reported as
+  // `InvalidArgument` and an empty payload as written to all ports
+  // a timeout of `0` waits until the payload has been written to all ports
+  std::vector<fanout_result_t> write_all(std::span<connection *const> conns,
+                                         payload_t payload, long timeout_ms);
+
+} // namespace sp
+
+#endif // SPP_FANOUT_HPP_INCLUDED
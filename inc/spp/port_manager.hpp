@@ -0,0 +1,112 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Keeps connections to a set of ports alive across disconnects.
+
+#ifndef SPP_PORT_MANAGER_HPP_INCLUDED
+#define SPP_PORT_MANAGER_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace sp {
+
+  // identifies a port independently of the name the OS assigns it
+  // unset fields (`-1`s or the empty string) are not taken into account
+  struct port_identity_t {
+    usb_vid_pid_t usb_vid_pid{-1, -1};
+    std::string usb_serial_no{};
+
+    // a stable path to the port, e.g. `/dev/serial/by-id/...`
+    // it is resolved anew on every lookup
+    std::string path{};
+  };
+
+  bool operator==(const port_identity_t &lhs, const port_identity_t &rhs);
+
+  // returns whether no field of the identity is set
+  bool is_empty(const port_identity_t &id) noexcept;
+
+  // returns whether the given port matches the USB fields of the identity
+  bool matches(const port_identity_t &id, const port_t &p);
+
+  // finds the port with the given identity among the candidates
+  // if the identity has a path, the candidates are ignored
+  // if no port matches, an invalid port is returned
+  port_t find_port(const port_identity_t &id,
+                   const std::vector<port_t> &candidates);
+
+  struct backoff_t {
+    std::chrono::milliseconds initial{100};
+    std::chrono::milliseconds max{10'000};
+
+    // fraction of each delay that is randomised, in the range [0, 1]
+    double jitter{0.25};
+  };
+
+  // computes the delay before the reconnect attempt that follows `attempt`
+  // failed attempts, where `random` is uniformly distributed in [0, 1)
+  std::chrono::milliseconds backoff_delay(const backoff_t &backoff, int attempt,
+                                          double random) noexcept;
+
+  // owns a connection per port identity and reconnects lost ports
+  // all (re-)connecting is done by a single supervisor thread, which uses the
+  // most recent configuration that was set for the port
+  class port_manager {
+   public:
+    explicit port_manager(backoff_t backoff = {});
+    ~port_manager();
+
+    port_manager(const port_manager &) = delete;
+    port_manager &operator=(const port_manager &) = delete;
+
+    port_manager(port_manager &&) = delete;
+    port_manager &operator=(port_manager &&) = delete;
+
+    // starts managing the identified port, connecting in the background
+    // returns `InvalidArgument` if the identity is empty or already managed
+    status_t add(const port_identity_t &id, mode_t m,
+                 const port_config_t &cfg = {});
+
+    // closes the identified port and stops managing it
+    // returns `InvalidArgument` if the identity is not managed
+    status_t remove(const port_identity_t &id);
+
+    bool is_connected(const port_identity_t &id) const;
+
+    // applies the configuration now, if connected, and after any reconnect
+    status_t set_config(const port_identity_t &id, const port_config_t &cfg);
+
+    // calls `fn` with the connection to the identified port
+    // if `fn` leaves a `SystemError` behind and the port does not respond
+    // anymore, the connection is closed and reestablished in the background
+    // returns `InvalidArgument` for unmanaged ports, `SystemError` for ports
+    // that are not connected, or else the status left behind by `fn`
+    status_t with_connection(const port_identity_t &id,
+                             const std::function<void(connection &)> &fn);
+
+   private:
+    struct entry;
+
+    std::shared_ptr<entry> find(const port_identity_t &id) const;
+    void schedule_reconnect();
+    void supervise(const std::stop_token &stop);
+
+    backoff_t backoff_;
+    mutable std::mutex mutex_;
+    std::condition_variable_any wakeup_;
+    bool reconnect_pending_{false};
+    std::vector<std::shared_ptr<entry>> entries_;
+    std::jthread supervisor_; // declared last, so it is stopped first
+  };
+
+} // namespace sp
+
+#endif // SPP_PORT_MANAGER_HPP_INCLUDED
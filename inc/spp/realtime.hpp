@@ -0,0 +1,68 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Sets up connections for deterministic latency.
+
+#ifndef SPP_REALTIME_HPP_INCLUDED
+#define SPP_REALTIME_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <cstddef>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  struct realtime_options_t {
+    // locks all current and future memory of the process, so that it cannot
+    // be paged out
+    bool lock_memory{true};
+    // SCHED_FIFO priority of the calling thread, `-1` leaves it alone
+    int priority{-1};
+    // see `connection::set_low_latency`
+    bool low_latency{true};
+    std::size_t rx_buffer_size{4'096U};
+    std::size_t tx_buffer_size{4'096U};
+  };
+
+  struct realtime_status_t {
+    // `NotSupported` where not requested or not available
+    status_t memory_locked{status_t::NotSupported};
+    status_t scheduling{status_t::NotSupported};
+    low_latency_t low_latency{.async_low_latency = status_t::NotSupported,
+                              .latency_timer = status_t::NotSupported,
+                              .latency_timer_ms = -1};
+  };
+
+  // reads and writes a connection through buffers that are allocated, and
+  // touched, during setup, after which neither allocates nor throws
+  // meant to be set up on the thread that is going to do the I/O, since
+  // that thread is the one raised to a real-time priority
+  // memory locking is process-wide and not undone
+  class realtime {
+   public:
+    explicit realtime(connection &conn, const realtime_options_t &options = {});
+
+    const realtime_status_t &get_realtime_status() const noexcept;
+
+    // blocks until any data is available or the timeout has expired
+    // returns what was read, empty on timeout or error (see `get_status`)
+    std::span<const std::byte> read(long timeout_ms) noexcept;
+
+    // a buffer to compose data in before passing it to `write`
+    std::span<std::byte> tx_buffer() noexcept;
+
+    // writes the first `count` bytes of the buffer to compose data in
+    // returns the number of bytes written, or -1 on error
+    int write(std::size_t count, long timeout_ms) noexcept;
+
+   private:
+    connection *conn_;
+    std::vector<std::byte> rx_;
+    std::vector<std::byte> tx_;
+    realtime_status_t status_;
+  };
+
+} // namespace sp
+
+#endif // SPP_REALTIME_HPP_INCLUDED
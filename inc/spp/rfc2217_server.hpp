@@ -0,0 +1,61 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Serves connections to network clients through RFC 2217.
+
+#ifndef SPP_RFC2217_SERVER_HPP_INCLUDED
+#define SPP_RFC2217_SERVER_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+namespace sp {
+
+  // serves any number of connections to network clients, one client per
+  // connection, which access it through the Telnet Com Port Control Option
+  // (RFC 2217), as e.g. ser2net does
+  // the baud rate and framing that a client sets are applied through
+  // `connection::set_config`, while flow control, DTR, RTS, breaks and
+  // purging buffers are passed on to libserialport
+  // notifications of line and modem state changes are not sent
+  // data a client sends is written to the port in one go per packet
+  // POSIX only
+  class rfc2217_server {
+   public:
+    rfc2217_server();
+    ~rfc2217_server();
+
+    rfc2217_server(const rfc2217_server &) = delete;
+    rfc2217_server &operator=(const rfc2217_server &) = delete;
+
+    rfc2217_server(rfc2217_server &&) = delete;
+    rfc2217_server &operator=(rfc2217_server &&) = delete;
+
+    // listens for a client of `conn` on the given TCP port of the IPv4
+    // address, `0` picking a free port, which must outlive the server
+    // returns the TCP port listened on
+    std::optional<std::uint16_t> listen(connection &conn,
+                                        std::uint16_t tcp_port,
+                                        const char *address = "127.0.0.1");
+
+    // waits for and handles whatever happens on the connections and clients,
+    // at most until the timeout has expired
+    // a timeout of `0` waits until anything happens
+    status_t serve(long timeout_ms);
+
+    // returns the number of clients connected
+    std::size_t clients() const noexcept;
+
+   private:
+    struct session;
+
+    std::vector<std::unique_ptr<session>> sessions_;
+  };
+
+} // namespace sp
+
+#endif // SPP_RFC2217_SERVER_HPP_INCLUDED
@@ -0,0 +1,179 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Shards connections across worker threads that are pinned to CPUs.
+
+#ifndef SPP_SHARDED_RUNTIME_HPP_INCLUDED
+#define SPP_SHARDED_RUNTIME_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  // a bounded queue that any number of threads push to and a single thread
+  // pops from, without locking
+  template <typename T> class handoff_queue {
+   public:
+    // the capacity is rounded up to a power of two
+    explicit handoff_queue(std::size_t capacity);
+
+    // returns false if the queue is full, in which case `value` is untouched
+    bool try_push(T &&value);
+
+    // must only be called by the consuming thread
+    std::optional<T> try_pop();
+
+    // returns whether the queue has been empty at some point during the call
+    bool empty() const noexcept;
+
+   private:
+    struct cell {
+      std::atomic<std::size_t> sequence;
+      std::optional<T> value;
+    };
+
+    static std::size_t round_up(std::size_t capacity) noexcept;
+
+    std::vector<cell> cells_;
+    std::size_t mask_;
+    // producers and the consumer each keep to a cache line of their own
+    alignas(64) std::atomic<std::size_t> tail_{0};
+    alignas(64) std::atomic<std::size_t> head_{0};
+  };
+
+  // called on the thread of the owning shard with data as it is received,
+  // and once with no data when the port has failed and been dropped
+  using rx_handler_t =
+      std::function<void(connection &conn, std::span<const std::byte> data)>;
+
+  // runs on the thread of the owning shard, with exclusive access to the port
+  using port_task_t = std::function<void(connection &conn)>;
+
+  // distributes connections across worker threads, each of which owns its
+  // ports exclusively and waits for them to become readable in a loop of its
+  // own, so that the I/O path needs no locking
+  // all interaction with a port is handed to its shard through a lock-free
+  // queue
+  // POSIX systems only, elsewhere no workers are started and `add` fails
+  class sharded_runtime {
+   public:
+    // starts a worker for each of the given CPUs, pinning it to that CPU
+    // before it takes on any work
+    // a CPU of `-1` leaves a worker unpinned
+    // if a worker cannot be set up, none are started, see `get_status`
+    explicit sharded_runtime(std::span<const int> cpus,
+                             std::size_t queue_capacity = 1'024U);
+    ~sharded_runtime();
+
+    sharded_runtime(const sharded_runtime &) = delete;
+    sharded_runtime &operator=(const sharded_runtime &) = delete;
+
+    sharded_runtime(sharded_runtime &&) = delete;
+    sharded_runtime &operator=(sharded_runtime &&) = delete;
+
+    std::size_t shards() const noexcept;
+
+    // returns `OK` unless the workers could not be started, in which case
+    // there are no shards, with `SystemError` if setting them up has failed
+    // or `NotSupported` where there are no workers
+    status_t get_status() const noexcept;
+
+    // returns the outcome of pinning the worker of the shard to its CPU
+    status_t get_affinity_status(std::size_t shard) const;
+
+    // hands the connection over to a shard, returning an id for the port, or
+    // `std::nullopt` if the queue of the shard is full, in which case the
+    // connection is closed
+    // without any shards, `std::nullopt` is returned and the status is that
+    // of the runtime, or `InvalidArgument` if it was given no CPUs
+    // ports are assigned to shards round-robin
+    std::optional<std::size_t> add(connection conn, rx_handler_t on_data);
+
+    // returns the shard that owns the identified port
+    std::size_t shard_of(std::size_t port_id) const noexcept;
+
+    // has the shard that owns the identified port run `task` on it
+    // returns false if the queue of the shard is full
+    bool post(std::size_t port_id, port_task_t task);
+
+    // has the shard that owns the identified port close it
+    // returns false if the queue of the shard is full
+    bool remove(std::size_t port_id);
+
+   private:
+    struct shard;
+
+    std::atomic<std::size_t> next_id_{0};
+    status_t status_{status_t::OK};
+    std::vector<std::unique_ptr<shard>> shards_;
+  };
+
+  template <typename T>
+  handoff_queue<T>::handoff_queue(const std::size_t capacity)
+      : cells_(round_up(capacity)), mask_{cells_.size() - 1U} {
+    for (auto i = std::size_t{0}; i < cells_.size(); ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  template <typename T> bool handoff_queue<T>::try_push(T &&value) {
+    auto pos = tail_.load(std::memory_order_relaxed);
+    while (true) {
+      auto &c = cells_[pos & mask_];
+      const auto diff = static_cast<std::intptr_t>(
+          c.sequence.load(std::memory_order_acquire) - pos);
+      if (diff == 0) {
+        // the cell is free, claim it
+        if (tail_.compare_exchange_weak(pos, pos + 1U,
+                                        std::memory_order_relaxed)) {
+          c.value.emplace(std::move(value));
+          c.sequence.store(pos + 1U, std::memory_order_release);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false; // the consumer has yet to free the cell
+      } else {
+        pos = tail_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  template <typename T> std::optional<T> handoff_queue<T>::try_pop() {
+    const auto pos = head_.load(std::memory_order_relaxed);
+    auto &c = cells_[pos & mask_];
+    if (c.sequence.load(std::memory_order_acquire) != pos + 1U) {
+      return std::nullopt;
+    }
+    auto result = std::move(c.value);
+    c.value.reset();
+    head_.store(pos + 1U, std::memory_order_relaxed);
+    c.sequence.store(pos + cells_.size(), std::memory_order_release);
+    return result;
+  }
+
+  template <typename T> bool handoff_queue<T>::empty() const noexcept {
+    const auto pos = head_.load(std::memory_order_relaxed);
+    return cells_[pos & mask_].sequence.load(std::memory_order_acquire)
+           != pos + 1U;
+  }
+
+  template <typename T>
+  std::size_t handoff_queue<T>::round_up(const std::size_t capacity) noexcept {
+    auto result = std::size_t{1};
+    while (result < capacity) {
+      result <<= 1U;
+    }
+    return result;
+  }
+
+} // namespace sp
+
+#endif // SPP_SHARDED_RUNTIME_HPP_INCLUDED
@@ -0,0 +1,172 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Carries out request/response transactions on a connection.
+
+#ifndef SPP_TRANSACTOR_HPP_INCLUDED
+#define SPP_TRANSACTOR_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace sp {
+
+  template <typename Allocator> struct basic_request_t {
+    std::uint64_t id;
+    std::vector<std::byte, Allocator> data;
+    std::chrono::steady_clock::time_point deadline;
+  };
+
+  template <typename Allocator> struct basic_response_t {
+    std::uint64_t id; // of the request that this is the response to
+    status_t status;
+    bool timed_out;
+    std::vector<std::byte, Allocator> data;
+    std::chrono::nanoseconds round_trip; // from sending to matching
+  };
+
+  // what a matcher found in the received data
+  struct match_t {
+    std::size_t length{0};  // of the response, `0` if it is still incomplete
+    std::size_t request{0}; // index of the outstanding request it answers
+  };
+
+  // finds a response at the beginning of the received data
+  // outstanding requests are passed in the order they have been sent
+  // a response that is matched to an index beyond the outstanding requests is
+  // considered unsolicited and discarded
+  template <typename Allocator>
+  using basic_matcher_t = std::function<match_t(
+      std::span<const std::byte> received,
+      std::span<const basic_request_t<Allocator>> outstanding)>;
+
+  using request_t = basic_request_t<std::allocator<std::byte>>;
+  using response_t = basic_response_t<std::allocator<std::byte>>;
+  using matcher_t = basic_matcher_t<std::allocator<std::byte>>;
+
+  // matches responses that end with the given byte, in the order of requests
+  matcher_t terminated_by(std::byte terminator);
+
+  // matches responses of the given length, in the order of requests
+  matcher_t fixed_length(std::size_t length);
+
+  namespace pmr {
+    using request_t =
+        basic_request_t<std::pmr::polymorphic_allocator<std::byte>>;
+    using response_t =
+        basic_response_t<std::pmr::polymorphic_allocator<std::byte>>;
+    using matcher_t =
+        basic_matcher_t<std::pmr::polymorphic_allocator<std::byte>>;
+
+    // as above, for transactors that allocate from a memory resource
+    matcher_t terminated_by(std::byte terminator);
+    matcher_t fixed_length(std::size_t length);
+  } // namespace pmr
+
+  struct latency_stats_t {
+    std::size_t count{0};
+    std::chrono::nanoseconds min{std::chrono::nanoseconds::max()};
+    std::chrono::nanoseconds max{0};
+    std::chrono::nanoseconds total{0};
+  };
+
+  // sends requests and matches the responses to them
+  // queued requests are sent earliest deadline first, and as many are kept in
+  // flight at once as the protocol permits, in which case they are written
+  // back-to-back
+  // a request that expires while in flight is reported as timed out right
+  // away, but stays outstanding until its response arrives, so that the late
+  // response cannot be mistaken for that to another request, or until it has
+  // been outstanding for as long again, so that a lost response does not keep
+  // its slot taken
+  // all buffers, including those of requests and responses, are allocated
+  // through `Allocator`, see `pmr::transactor` to allocate from a memory
+  // resource
+  template <typename Allocator> class basic_transactor {
+   public:
+    using allocator_type = Allocator;
+    using request_type = basic_request_t<Allocator>;
+    using response_type = basic_response_t<Allocator>;
+    using matcher_type = basic_matcher_t<Allocator>;
+
+    template <typename T>
+    using vector_type = std::vector<
+        T, typename std::allocator_traits<Allocator>::template rebind_alloc<T>>;
+
+    basic_transactor(connection &conn, matcher_type matcher,
+                     std::size_t max_in_flight = 1U,
+                     const Allocator &alloc = Allocator{});
+
+    // queues a request, returns its id
+    std::uint64_t submit(std::span<const std::byte> request,
+                         std::chrono::steady_clock::time_point deadline);
+
+    // sends queued requests and receives responses until at least one
+    // transaction has finished, i.e. completed or expired, or the timeout has
+    // expired, appending all finished transactions to `finished`
+    // a timeout of `0` waits until a transaction has finished
+    status_t process(vector_type<response_type> &finished, long timeout_ms);
+
+    // carries out a single transaction, blocking until it has finished
+    // a timeout of `0` waits indefinitely
+    response_type transact(std::span<const std::byte> request,
+                           long timeout_ms);
+
+    // returns the number of requests that are queued or in flight and have
+    // not finished yet, i.e. requests that expired in flight are not counted
+    // even though they stay outstanding
+    std::size_t pending() const noexcept;
+
+    // forgets all outstanding requests and discards any received data
+    status_t reset();
+
+    const latency_stats_t &latencies() const noexcept;
+
+   private:
+    struct in_flight_t {
+      std::chrono::steady_clock::time_point sent_at;
+      bool expired;
+      std::chrono::steady_clock::time_point forget_at; // once `expired`
+    };
+
+    void expire(vector_type<response_type> &finished);
+    void send(vector_type<response_type> &finished);
+    void match(vector_type<response_type> &finished);
+    long wait_time_ms(std::chrono::steady_clock::time_point until) const;
+
+    connection *conn_;
+    Allocator alloc_;
+    matcher_type matcher_;
+    std::size_t max_in_flight_;
+    std::uint64_t next_id_{0};
+    vector_type<request_type> queued_;      // ordered by deadline
+    vector_type<request_type> outstanding_; // ordered as sent
+    vector_type<in_flight_t> in_flight_;    // parallel to `outstanding_`
+    vector_type<std::byte> rx_;
+    vector_type<std::byte> tx_;
+    latency_stats_t latencies_;
+  };
+
+  // instantiated for these allocators in the implementation
+  extern template class basic_transactor<std::allocator<std::byte>>;
+  extern template class basic_transactor<
+      std::pmr::polymorphic_allocator<std::byte>>;
+
+  using transactor = basic_transactor<std::allocator<std::byte>>;
+
+  namespace pmr {
+    // allocates from the memory resource that it is constructed with
+    using transactor =
+        basic_transactor<std::pmr::polymorphic_allocator<std::byte>>;
+  } // namespace pmr
+
+} // namespace sp
+
+#endif // SPP_TRANSACTOR_HPP_INCLUDED
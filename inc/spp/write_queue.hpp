@@ -0,0 +1,129 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Queues writes to a connection and drains them in the background.
+
+#ifndef SPP_WRITE_QUEUE_HPP_INCLUDED
+#define SPP_WRITE_QUEUE_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory_resource>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <vector>
+
+namespace sp {
+
+  struct write_queue_options_t {
+    std::size_t capacity{64U * 1024U}; // in bytes
+    // the high watermark callback is called when the queue fills up beyond
+    // `high_watermark` bytes, and the low watermark callback when it has
+    // drained down to `low_watermark` bytes thereafter
+    std::size_t high_watermark{48U * 1024U};
+    std::size_t low_watermark{16U * 1024U};
+    // keeps the output buffer of the driver from holding more than this many
+    // bytes, so that data which is queued later is not held up behind it
+    // `-1` lets the driver buffer as much as it takes
+    int max_output_waiting{-1};
+  };
+
+  // a bounded queue of data to be written to a connection
+  // the queue is drained by a thread of its own, which writes whenever the
+  // port is ready to take data
+  // data is queued either as a whole or not at all, so that writes of
+  // different producers are never interleaved
+  class write_queue {
+   public:
+    // the queue, as well as the state shared with futures, is allocated from
+    // `resource`
+    explicit write_queue(connection &conn, write_queue_options_t options = {},
+                         std::pmr::memory_resource *resource =
+                             std::pmr::get_default_resource());
+    // stops draining, discarding any data still queued
+    ~write_queue();
+
+    write_queue(const write_queue &) = delete;
+    write_queue &operator=(const write_queue &) = delete;
+
+    write_queue(write_queue &&) = delete;
+    write_queue &operator=(write_queue &&) = delete;
+
+    // blocks until there is room for `data` or the timeout has expired
+    // a timeout of `0` waits indefinitely
+    // returns the number of bytes queued, i.e. the size of `data` or `0` on
+    // timeout, or -1 if `data` exceeds the capacity or draining has failed
+    int write_blocking(std::span<const std::byte> data, long timeout_ms);
+
+    // queues `data` only if there is room for it right away
+    // returns the number of bytes queued, or -1 as with `write_blocking`
+    int write_nonblocking(std::span<const std::byte> data);
+
+    // queues `data` as soon as there is room for it, after any data that has
+    // been passed to earlier calls
+    // the result becomes ready once the data is queued, with the same values
+    // as returned by `write_blocking`
+    std::future<int> write_async(std::span<const std::byte> data);
+
+    // blocks until all queued data has been handed to the driver, draining
+    // has failed or the timeout has expired, with `0` waiting indefinitely
+    // returns whether the queue is empty
+    bool drain(long timeout_ms);
+
+    // returns the status of draining, which is `OK` unless a write has failed
+    status_t get_status() const;
+
+    // returns the number of bytes queued
+    std::size_t size() const;
+
+    // the callbacks are called from the thread of the producer or the one
+    // draining the queue, one at a time and in the order in which the
+    // watermarks were crossed, without the lock of the queue held, so that
+    // they may queue data themselves
+    void on_high_watermark(std::function<void()> fn);
+    void on_low_watermark(std::function<void()> fn);
+
+   private:
+    struct deferred_t {
+      std::pmr::vector<std::byte> data;
+      std::promise<int> queued;
+    };
+
+    bool fits(std::size_t size) const noexcept;
+    bool push(std::span<const std::byte> data);
+    bool pop(std::size_t size);
+    bool admit_deferred();
+    void notify();
+    std::size_t allowance(long character_time_us);
+    void run(const std::stop_token &stop);
+
+    connection *conn_;
+    std::pmr::memory_resource *resource_;
+    write_queue_options_t options_;
+    std::function<void()> on_high_;
+    std::function<void()> on_low_;
+    std::recursive_mutex notify_mutex_; // callbacks may queue data
+    std::uint64_t delivered_{0};        // crossings, under `notify_mutex_`
+
+    mutable std::mutex mutex_;
+    std::condition_variable_any changed_;
+    std::pmr::vector<std::byte> ring_;
+    std::size_t head_{0};
+    std::size_t size_{0};
+    bool above_high_{false};
+    std::uint64_t crossings_{0}; // of either watermark
+    status_t status_{status_t::OK};
+    std::pmr::deque<deferred_t> deferred_;
+
+    std::jthread drainer_; // declared last, so it is stopped first
+  };
+
+} // namespace sp
+
+#endif // SPP_WRITE_QUEUE_HPP_INCLUDED
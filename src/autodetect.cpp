@@ -0,0 +1,167 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Detects the baud rate and framing of a port from the traffic on it.
+
+#include <spp/autodetect.hpp>
+
+#include "for_each_parallel.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <exception>
+
+namespace {
+  struct sample_t {
+    std::size_t bytes{0U};
+    std::size_t errors{0U};
+    double score{0.0};
+  };
+
+  // listens to the candidate in effect until enough has been received
+  sample_t sample(sp::connection &conn, const sp::autodetect_options_t &options,
+                  std::vector<std::byte> &data,
+                  std::vector<sp::line_event_t> &events) {
+    using std::chrono::steady_clock;
+    const auto deadline =
+        steady_clock::now() + std::chrono::milliseconds{options.sample_ms};
+    data.resize(std::max<std::size_t>(options.sample_bytes, 1U));
+    events.clear();
+
+    auto result = sample_t{};
+    while (result.bytes < data.size()) {
+      const auto remaining =
+          std::chrono::ceil<std::chrono::milliseconds>(deadline
+                                                       - steady_clock::now())
+              .count();
+      if (remaining <= 0) {
+        break;
+      }
+      const auto ret = conn.read_marked(
+          data.data() + result.bytes,
+          static_cast<int>(data.size() - result.bytes),
+          static_cast<long>(remaining), events);
+      if (ret < 0) {
+        break;
+      }
+      result.bytes += static_cast<std::size_t>(ret);
+    }
+    data.resize(result.bytes);
+
+    // overruns tell nothing about the settings
+    result.errors = static_cast<std::size_t>(
+        std::ranges::count_if(events, [](const sp::line_event_t &e) {
+          return e.error != sp::line_error_t::Overrun;
+        }));
+    if (result.bytes == 0U) {
+      return result;
+    }
+    // breaks leave no byte, but count as characters received
+    const auto received = result.bytes + result.errors;
+    result.score = 1.0 - static_cast<double>(result.errors)
+                             / static_cast<double>(received);
+    if (options.content_score) {
+      result.score *= std::clamp(options.content_score(data), 0.0, 1.0);
+    }
+    return result;
+  }
+} // namespace
+
+double sp::score_text(const std::span<const std::byte> data) noexcept {
+  if (data.empty()) {
+    return 0.0;
+  }
+  const auto printable = std::ranges::count_if(data, [](const std::byte b) {
+    const auto c = std::to_integer<unsigned>(b);
+    return (c >= 0x20U && c < 0x7fU) || c == '\t' || c == '\r' || c == '\n';
+  });
+  return static_cast<double>(printable) / static_cast<double>(data.size());
+}
+
+sp::autodetect_result_t sp::autodetect(connection &conn,
+                                       const autodetect_options_t &options) {
+  auto result = autodetect_result_t{};
+  const auto original = conn.get_config();
+  auto data = std::vector<std::byte>{};
+  auto events = std::vector<line_event_t>{};
+  data.reserve(options.sample_bytes);
+
+  // kept up by `set_config` from candidate to candidate
+  if ((result.status = conn.set_error_marking(true)) != status_t::OK) {
+    result.config = original;
+    return result;
+  }
+
+  auto current = original;
+  auto done = false;
+  for (const auto baud_rate : options.baud_rates) {
+    for (const auto &framing : options.framings) {
+      const auto candidate = port_config_t{.baud_rate = baud_rate,
+                                           .bits = framing.bits,
+                                           .stop_bits = framing.stop_bits,
+                                           .parity = framing.parity};
+      // only what differs from the candidate before is applied
+      const auto changed = [](const auto next, const auto now,
+                              const auto alone) {
+        return next == now ? alone : next;
+      };
+      const auto status = conn.set_config(
+          {.baud_rate = changed(candidate.baud_rate, current.baud_rate, -1),
+           .bits = changed(candidate.bits, current.bits, -1),
+           .stop_bits = changed(candidate.stop_bits, current.stop_bits, -1),
+           .parity =
+               changed(candidate.parity, current.parity, parity_t::Invalid)});
+      if (status != status_t::OK) {
+        // the port does not support this candidate, but may have taken some
+        // of its settings before it failed
+        current = conn.get_config();
+        continue;
+      }
+      current = candidate;
+      conn.flush(buffer_t::Rx);
+      if (options.probe) {
+        options.probe(conn, candidate);
+      }
+
+      const auto s = sample(conn, options, data, events);
+      ++result.candidates;
+      if (s.score > result.score) {
+        result.score = s.score;
+        result.config = candidate;
+      }
+      if (s.score >= options.confident_score && s.bytes >= options.min_bytes) {
+        done = true;
+        break;
+      }
+    }
+    if (done) {
+      break;
+    }
+  }
+
+  conn.set_error_marking(false);
+  if (result.score <= 0.0) {
+    result.config = original;
+  }
+  const auto status = conn.set_config(result.config);
+  if (result.status == status_t::OK) {
+    result.status = status;
+  }
+  return result;
+}
+
+std::vector<sp::autodetect_result_t>
+sp::autodetect(const std::span<connection> conns,
+               const autodetect_options_t &options,
+               const unsigned max_workers) {
+  auto results = std::vector<autodetect_result_t>(conns.size());
+  detail::for_each_parallel(conns.size(), max_workers,
+                            [&](const std::size_t i) {
+                              try {
+                                results[i] = autodetect(conns[i], options);
+                              } catch (const std::exception &) {
+                                results[i].status = status_t::SystemError;
+                              }
+                            });
+  return results;
+}
@@ -0,0 +1,418 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Submits reads and writes on many connections at once.
+
+#include <spp/batch_io.hpp>
+
+#include "status.hpp"
+
+#include <libserialport.h>
+
+#include <config.h>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+
+#if defined(SP_WITH_IO_URING) && defined(HAVE_LINUX_IO_URING_H)
+#define SP_USE_IO_URING 1
+#include <linux/io_uring.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <ctime>
+#include <optional>
+#endif
+
+struct sp::batch_io::operation {
+  connection *conn;
+  int fd;
+  std::byte *buf;
+  std::size_t size;
+  std::uint64_t user_data;
+  bool is_write;
+  bool needs_poll; // submit behind a poll, after the port refused to block
+};
+
+namespace {
+  using std::chrono::steady_clock;
+
+  long remaining_ms(const steady_clock::time_point deadline) {
+    return std::max(0L, static_cast<long>(
+                            std::chrono::duration_cast<std::chrono::milliseconds>(
+                                deadline - steady_clock::now())
+                                .count()));
+  }
+} // namespace
+
+#ifdef SP_USE_IO_URING
+
+struct sp::batch_io::ring {
+  // marks the poll in front of an operation, whose completion is not reported
+  static constexpr auto poll_tag = std::uint64_t{1} << 63U;
+
+  int fd{-1};
+  io_uring_params params{};
+  void *sq_ring{MAP_FAILED};
+  std::size_t sq_ring_size{0};
+  void *cq_ring{MAP_FAILED};
+  std::size_t cq_ring_size{0};
+  io_uring_sqe *sqes{static_cast<io_uring_sqe *>(MAP_FAILED)};
+  std::size_t sqes_size{0};
+
+  std::vector<std::optional<operation>> slots;
+  std::vector<unsigned> free_slots;
+  std::vector<iovec> registered;
+
+  ring() = default;
+  ring(const ring &) = delete;
+  ring &operator=(const ring &) = delete;
+  ring(ring &&) = delete;
+  ring &operator=(ring &&) = delete;
+
+  ~ring() {
+    if (sqes != MAP_FAILED) {
+      munmap(sqes, sqes_size);
+    }
+    if (cq_ring != MAP_FAILED && cq_ring != sq_ring) {
+      munmap(cq_ring, cq_ring_size);
+    }
+    if (sq_ring != MAP_FAILED) {
+      munmap(sq_ring, sq_ring_size);
+    }
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+
+  static std::unique_ptr<ring> create(const unsigned depth) {
+    auto r = std::make_unique<ring>();
+    // every operation might need a poll in front of it
+    r->fd = static_cast<int>(
+        syscall(__NR_io_uring_setup, depth * 2U, &r->params));
+    if (r->fd < 0 || (r->params.features & IORING_FEAT_EXT_ARG) == 0U) {
+      return nullptr;
+    }
+
+    r->sq_ring_size =
+        r->params.sq_off.array + r->params.sq_entries * sizeof(unsigned);
+    r->cq_ring_size =
+        r->params.cq_off.cqes + r->params.cq_entries * sizeof(io_uring_cqe);
+    const auto single_mmap =
+        (r->params.features & IORING_FEAT_SINGLE_MMAP) != 0U;
+    if (single_mmap) {
+      r->sq_ring_size = r->cq_ring_size =
+          std::max(r->sq_ring_size, r->cq_ring_size);
+    }
+    r->sq_ring = mmap(nullptr, r->sq_ring_size, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED) {
+      return nullptr;
+    }
+    r->cq_ring = single_mmap
+                     ? r->sq_ring
+                     : mmap(nullptr, r->cq_ring_size, PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_POPULATE, r->fd,
+                            IORING_OFF_CQ_RING);
+    r->sqes_size = r->params.sq_entries * sizeof(io_uring_sqe);
+    r->sqes = static_cast<io_uring_sqe *>(
+        mmap(nullptr, r->sqes_size, PROT_READ | PROT_WRITE,
+             MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES));
+    if (r->cq_ring == MAP_FAILED || r->sqes == MAP_FAILED) {
+      return nullptr;
+    }
+
+    r->slots.resize(depth);
+    for (auto i = depth; i > 0U; --i) {
+      r->free_slots.push_back(i - 1U);
+    }
+    return r;
+  }
+
+  unsigned *sq_field(const unsigned offset) const {
+    return reinterpret_cast<unsigned *>(static_cast<char *>(sq_ring) + offset);
+  }
+
+  unsigned *cq_field(const unsigned offset) const {
+    return reinterpret_cast<unsigned *>(static_cast<char *>(cq_ring) + offset);
+  }
+
+  unsigned sq_space() const {
+    const auto head = std::atomic_ref{*sq_field(params.sq_off.head)}.load(
+        std::memory_order_acquire);
+    return params.sq_entries - (*sq_field(params.sq_off.tail) - head);
+  }
+
+  io_uring_sqe &push_sqe() {
+    auto *const tail = sq_field(params.sq_off.tail);
+    const auto index = *tail & *sq_field(params.sq_off.ring_mask);
+    sq_field(params.sq_off.array)[index] = index;
+    auto &sqe = sqes[index];
+    sqe = io_uring_sqe{};
+    std::atomic_ref{*tail}.store(*tail + 1U, std::memory_order_release);
+    return sqe;
+  }
+
+  int buffer_index(const operation &op) const {
+    const auto *const begin = op.buf;
+    const auto *const end = op.buf + op.size;
+    for (auto i = 0U; i < registered.size(); ++i) {
+      const auto *const base =
+          static_cast<const std::byte *>(registered[i].iov_base);
+      if (begin >= base && end <= base + registered[i].iov_len) {
+        return static_cast<int>(i);
+      }
+    }
+    return -1;
+  }
+
+  // returns the number of entries added to the submission queue
+  unsigned push(const operation &op) {
+    const auto slot = free_slots.back();
+    free_slots.pop_back();
+    slots[slot] = op;
+
+    auto count = 0U;
+    if (op.needs_poll) {
+      auto &poll = push_sqe();
+      poll.opcode = IORING_OP_POLL_ADD;
+      poll.fd = op.fd;
+      poll.poll32_events = op.is_write ? POLLOUT : POLLIN;
+      poll.flags = IOSQE_IO_LINK;
+      poll.user_data = poll_tag | slot;
+      ++count;
+    }
+    auto &sqe = push_sqe();
+    const auto buf_index = buffer_index(op);
+    if (buf_index >= 0) {
+      sqe.opcode = op.is_write ? IORING_OP_WRITE_FIXED : IORING_OP_READ_FIXED;
+      sqe.buf_index = static_cast<std::uint16_t>(buf_index);
+    } else {
+      sqe.opcode = op.is_write ? IORING_OP_WRITE : IORING_OP_READ;
+    }
+    sqe.fd = op.fd;
+    sqe.addr = reinterpret_cast<std::uintptr_t>(op.buf);
+    sqe.len = static_cast<std::uint32_t>(op.size);
+    sqe.off = ~std::uint64_t{0}; // ports are not seekable
+    sqe.user_data = slot;
+    return count + 1U;
+  }
+
+  // returns -1 on error, or else the number of entries submitted
+  int enter(const unsigned to_submit, const unsigned min_complete,
+            const long timeout_ms) const {
+    auto ts = timespec{timeout_ms / 1000L, (timeout_ms % 1000L) * 1'000'000L};
+    auto arg = io_uring_getevents_arg{};
+    if (timeout_ms > 0) {
+      arg.ts = reinterpret_cast<std::uintptr_t>(&ts);
+    }
+    return static_cast<int>(syscall(
+        __NR_io_uring_enter, fd, to_submit, min_complete,
+        IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg, sizeof(arg)));
+  }
+};
+
+#else
+
+struct sp::batch_io::ring {};
+
+#endif
+
+sp::batch_io::batch_io(const unsigned depth,
+                       [[maybe_unused]] const bool use_io_uring,
+                       std::pmr::memory_resource *const resource)
+    : depth_{depth}, queued_{resource} {
+  queued_.reserve(depth);
+#ifdef SP_USE_IO_URING
+  if (use_io_uring) {
+    ring_ = ring::create(depth);
+  }
+#endif
+}
+
+sp::batch_io::~batch_io() = default;
+
+bool sp::batch_io::is_accelerated() const noexcept { return ring_ != nullptr; }
+
+sp::status_t sp::batch_io::register_buffers(
+    [[maybe_unused]] const std::span<const std::span<std::byte>> buffers) {
+#ifdef SP_USE_IO_URING
+  if (ring_) {
+    if (!ring_->registered.empty()) {
+      syscall(__NR_io_uring_register, ring_->fd, IORING_UNREGISTER_BUFFERS,
+              nullptr, 0);
+      ring_->registered.clear();
+    }
+    auto iovecs = std::vector<iovec>{};
+    for (const auto &buf : buffers) {
+      iovecs.push_back({buf.data(), buf.size()});
+    }
+    if (syscall(__NR_io_uring_register, ring_->fd, IORING_REGISTER_BUFFERS,
+                iovecs.data(), iovecs.size())
+        < 0) {
+      return detail::set_status(status_t::SystemError);
+    }
+    ring_->registered = std::move(iovecs);
+    return detail::set_status(status_t::OK);
+  }
+#endif
+  return detail::set_status(status_t::NotSupported);
+}
+
+sp::status_t sp::batch_io::read(connection &conn,
+                                const std::span<std::byte> buf,
+                                const std::uint64_t user_data) {
+  if (buf.empty() || pending() >= depth_) {
+    return detail::set_status(status_t::InvalidArgument);
+  }
+  auto fd = -1;
+  if (ring_ && get_native_handle(conn.get_port(), &fd) != status_t::OK) {
+    return detail::set_status(status_t::NotSupported);
+  }
+  queued_.push_back({&conn, fd, buf.data(), buf.size(), user_data, false,
+                     false});
+  return detail::set_status(status_t::OK);
+}
+
+sp::status_t sp::batch_io::write(connection &conn,
+                                 const std::span<const std::byte> buf,
+                                 const std::uint64_t user_data) {
+  if (buf.empty() || pending() >= depth_) {
+    return detail::set_status(status_t::InvalidArgument);
+  }
+  auto fd = -1;
+  if (ring_ && get_native_handle(conn.get_port(), &fd) != status_t::OK) {
+    return detail::set_status(status_t::NotSupported);
+  }
+  // the buffer is only ever read from
+  queued_.push_back({&conn, fd, const_cast<std::byte *>(buf.data()), buf.size(),
+                     user_data, true, false});
+  return detail::set_status(status_t::OK);
+}
+
+std::size_t sp::batch_io::pending() const noexcept {
+#ifdef SP_USE_IO_URING
+  if (ring_) {
+    return queued_.size() + (depth_ - ring_->free_slots.size());
+  }
+#endif
+  return queued_.size();
+}
+
+sp::status_t sp::batch_io::wait(std::vector<completion_t> &completions,
+                                const long timeout_ms) {
+  if (timeout_ms < 0) {
+    return detail::set_status(status_t::InvalidArgument);
+  }
+#ifdef SP_USE_IO_URING
+  if (ring_) {
+    const auto deadline =
+        steady_clock::now() + std::chrono::milliseconds{timeout_ms};
+    const auto initial_count = completions.size();
+
+    while (completions.size() == initial_count && pending() > 0U) {
+      auto to_submit = 0U;
+      auto it = queued_.begin();
+      for (; it != queued_.end() && !ring_->free_slots.empty()
+             && ring_->sq_space() >= 2U;
+           ++it) {
+        to_submit += ring_->push(*it);
+      }
+      queued_.erase(queued_.begin(), it);
+
+      const auto remaining = timeout_ms > 0 ? remaining_ms(deadline) : 0L;
+      if (timeout_ms > 0 && remaining == 0L && to_submit == 0U) {
+        break;
+      }
+      if (ring_->enter(to_submit, 1U, timeout_ms > 0 ? std::max(remaining, 1L)
+                                                     : 0L)
+              < 0
+          && errno != ETIME && errno != EINTR) {
+        return detail::set_status(status_t::SystemError);
+      }
+
+      auto *const head = ring_->cq_field(ring_->params.cq_off.head);
+      const auto tail = std::atomic_ref{*ring_->cq_field(
+                                            ring_->params.cq_off.tail)}
+                            .load(std::memory_order_acquire);
+      const auto mask = *ring_->cq_field(ring_->params.cq_off.ring_mask);
+      const auto *const cqes = reinterpret_cast<const io_uring_cqe *>(
+          static_cast<char *>(ring_->cq_ring) + ring_->params.cq_off.cqes);
+      for (auto i = *head; i != tail; ++i) {
+        const auto &cqe = cqes[i & mask];
+        if ((cqe.user_data & ring::poll_tag) != 0U) {
+          continue; // a failed poll cancels the operation behind it
+        }
+        const auto slot = static_cast<unsigned>(cqe.user_data);
+        auto op = *ring_->slots[slot];
+        ring_->slots[slot].reset();
+        ring_->free_slots.push_back(slot);
+        if (cqe.res == -EAGAIN) {
+          // the port is non-blocking, so wait for it to become ready first
+          op.needs_poll = true;
+          queued_.push_back(op);
+        } else {
+          completions.push_back(
+              {op.user_data, cqe.res >= 0 ? cqe.res : -1,
+               cqe.res >= 0 ? status_t::OK : status_t::SystemError});
+        }
+      }
+      std::atomic_ref{*head}.store(tail, std::memory_order_release);
+
+      if (timeout_ms > 0 && steady_clock::now() >= deadline) {
+        break;
+      }
+    }
+    return detail::set_status(status_t::OK);
+  }
+#endif
+  return wait_fallback(completions, timeout_ms);
+}
+
+sp::status_t sp::batch_io::wait_fallback(std::vector<completion_t> &completions,
+                                         const long timeout_ms) {
+  const auto deadline = steady_clock::now() + std::chrono::milliseconds{timeout_ms};
+  const auto initial_count = completions.size();
+
+  while (!queued_.empty()) {
+    std::erase_if(queued_, [&completions](const operation &op) {
+      const auto count = static_cast<int>(op.size);
+      const auto ret = op.is_write ? op.conn->write_nonblocking(op.buf, count)
+                                   : op.conn->read_nonblocking(op.buf, count);
+      if (ret == 0) {
+        return false;
+      }
+      completions.push_back(
+          {op.user_data, ret, ret >= 0 ? status_t::OK : get_status()});
+      return true;
+    });
+    if (completions.size() != initial_count) {
+      break;
+    }
+
+    const auto remaining = timeout_ms > 0 ? remaining_ms(deadline) : 0L;
+    if (timeout_ms > 0 && remaining == 0L) {
+      break;
+    }
+
+    sp_event_set *events_raw_ptr = nullptr;
+    if (sp_new_event_set(&events_raw_ptr) != SP_OK) {
+      return detail::set_status(status_t::SystemError);
+    }
+    const auto events = std::unique_ptr<sp_event_set, void (*)(sp_event_set *)>{
+        events_raw_ptr, sp_free_event_set};
+    for (const auto &op : queued_) {
+      sp_add_port_events(events.get(), op.conn->get_port().get(),
+                         op.is_write ? SP_EVENT_TX_READY : SP_EVENT_RX_READY);
+    }
+    if (sp_wait(events.get(), static_cast<unsigned>(remaining)) != SP_OK) {
+      return detail::set_status(status_t::SystemError);
+    }
+  }
+  return detail::set_status(status_t::OK);
+}
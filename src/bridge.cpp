@@ -0,0 +1,410 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Relays data between two connections in both directions.
+
+#include <spp/bridge.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <utility>
+#include <vector>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  constexpr auto chunk_size = std::size_t{16'384};
+
+#ifdef __linux__
+  bool would_block() {
+    return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+  }
+
+  // writes as much as a nonblocking descriptor takes right away, returns how
+  // much that is, or `-1` if it has failed
+  ssize_t write_available(const int fd, const std::byte *const data,
+                          const std::size_t count) {
+    auto done = std::size_t{0};
+    while (done < count) {
+      const auto ret = write(fd, data + done, count - done);
+      if (ret < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return would_block() ? static_cast<ssize_t>(done) : -1;
+      }
+      done += static_cast<std::size_t>(ret);
+    }
+    return static_cast<ssize_t>(done);
+  }
+
+  // reads and discards data that is known to be in a pipe
+  bool discard(const int fd, std::size_t count) {
+    auto scratch = std::array<std::byte, 4'096>{};
+    while (count > 0U) {
+      const auto ret =
+          read(fd, scratch.data(), std::min(count, scratch.size()));
+      if (ret <= 0) {
+        return false;
+      }
+      count -= static_cast<std::size_t>(ret);
+    }
+    return true;
+  }
+
+  void close_pipe(std::array<int, 2> &fds) {
+    for (auto &fd : fds) {
+      if (fd >= 0) {
+        close(fd);
+        fd = -1;
+      }
+    }
+  }
+#endif
+} // namespace
+
+// one direction of the bridge
+// data taken from `src` is held either in `pipe` (spliced) or in `buf` until
+// `dst` has taken all of it
+struct sp::bridge::lane {
+  lane(const int src_fd, const int dst_fd, const int capture_fd,
+       const bool use_splice)
+      : src{src_fd}, dst{dst_fd}, capture{capture_fd} {
+#ifdef __linux__
+    if (use_splice && pipe2(pipe.data(), O_CLOEXEC) == 0) {
+      spliced = capture < 0 || pipe2(tap.data(), O_CLOEXEC) == 0;
+    }
+#endif
+    if (!spliced) {
+      buf.resize(chunk_size);
+    }
+  }
+
+  ~lane() {
+#ifdef __linux__
+    close_pipe(pipe);
+    close_pipe(tap);
+#endif
+  }
+
+  lane(const lane &) = delete;
+  lane &operator=(const lane &) = delete;
+
+  lane(lane &&) = delete;
+  lane &operator=(lane &&) = delete;
+
+#ifdef __linux__
+  // switches to copying, keeping whatever is in the pipe
+  bool fall_back() {
+    buf.resize(chunk_size);
+    offset = 0U;
+    auto held = std::size_t{0};
+    while (held < pending) {
+      const auto ret = read(pipe[0], buf.data() + held, pending - held);
+      if (ret <= 0) {
+        return false;
+      }
+      held += static_cast<std::size_t>(ret);
+    }
+    close_pipe(pipe);
+    close_pipe(tap);
+    spliced = false;
+    return true;
+  }
+
+  // hands a copy of the data just taken to the capture sink, which is given
+  // up on if it fails
+  // what the sink does not take right away is dropped, so that a slow sink
+  // does not hold up relaying
+  void tee_to_capture(const std::size_t count) {
+    if (capture < 0) {
+      return;
+    }
+    if (!spliced) {
+      const auto ret = write_available(capture, buf.data(), count);
+      if (ret < 0) {
+        capture = -1;
+        return;
+      }
+      dropped += count - static_cast<std::size_t>(ret);
+      return;
+    }
+    // the tap is empty, so it takes the whole chunk
+    if (tee(pipe[0], tap[1], count, 0) != static_cast<ssize_t>(count)) {
+      capture = -1;
+      return;
+    }
+    auto remaining = count;
+    while (remaining > 0U) {
+      const auto ret = splice(tap[0], nullptr, capture, nullptr, remaining,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (ret > 0) {
+        remaining -= static_cast<std::size_t>(ret);
+      } else if (ret < 0 && errno == EINTR) {
+        continue;
+      } else if (ret < 0 && errno == EINVAL) {
+        // the sink does not support splicing, so the tap is copied out
+        auto copy = std::array<std::byte, 4'096>{};
+        const auto n = read(tap[0], copy.data(),
+                            std::min(remaining, copy.size()));
+        const auto written =
+            n > 0 ? write_available(capture, copy.data(),
+                                    static_cast<std::size_t>(n))
+                  : -1;
+        if (written < 0) {
+          capture = -1;
+          return;
+        }
+        remaining -= static_cast<std::size_t>(n);
+        dropped += static_cast<std::uint64_t>(n - written);
+      } else if (ret < 0 && would_block()) {
+        // the tap is emptied for the next chunk
+        if (!discard(tap[0], remaining)) {
+          capture = -1;
+          return;
+        }
+        dropped += remaining;
+        remaining = 0U;
+      } else {
+        capture = -1;
+        return;
+      }
+    }
+  }
+
+  // takes whatever `src` has to offer, returns `false` once it has failed
+  bool fill() {
+    if (spliced) {
+      const auto ret = splice(src, nullptr, pipe[1], nullptr, chunk_size,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (ret > 0) {
+        pending = static_cast<std::size_t>(ret);
+        tee_to_capture(pending);
+        return true;
+      }
+      if (ret == 0 || errno != EINVAL) {
+        return ret < 0 && would_block();
+      }
+      // the driver does not support splicing
+      if (!fall_back()) {
+        return false;
+      }
+    }
+    const auto ret = read(src, buf.data(), buf.size());
+    if (ret <= 0) {
+      return ret < 0 && would_block();
+    }
+    pending = static_cast<std::size_t>(ret);
+    offset = 0U;
+    tee_to_capture(pending);
+    return true;
+  }
+
+  // passes on as much as `dst` takes, returns `false` once it has failed
+  bool drain() {
+    if (spliced) {
+      const auto ret = splice(pipe[0], nullptr, dst, nullptr, pending,
+                              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+      if (ret >= 0 || errno != EINVAL) {
+        return advance(ret);
+      }
+      if (!fall_back()) {
+        return false;
+      }
+    }
+    return advance(write(dst, buf.data() + offset, pending));
+  }
+
+  bool advance(const ssize_t ret) {
+    if (ret < 0) {
+      return would_block();
+    }
+    pending -= static_cast<std::size_t>(ret);
+    offset += static_cast<std::size_t>(ret);
+    relayed += static_cast<std::uint64_t>(ret);
+    return true;
+  }
+#endif
+
+  int src;
+  int dst;
+  int capture;
+  std::atomic<bool> spliced{false};
+  std::array<int, 2> pipe{-1, -1};
+  std::array<int, 2> tap{-1, -1}; // copies for the capture sink
+  std::size_t pending{0};         // taken from `src` but not yet passed on
+  std::vector<std::byte> buf;
+  std::size_t offset{0}; // of the pending data in `buf`
+  std::atomic<std::uint64_t> relayed{0};
+  std::atomic<std::uint64_t> dropped{0}; // not taken by the capture sink
+};
+
+sp::bridge::bridge(connection &a, connection &b,
+                   const bridge_options_t &options) {
+#ifdef __linux__
+  auto fd_a = -1;
+  auto fd_b = -1;
+  if (get_native_handle(a.get_port(), &fd_a) != status_t::OK
+      || get_native_handle(b.get_port(), &fd_b) != status_t::OK || fd_a < 0
+      || fd_b < 0) {
+    status_ = status_t::SystemError;
+    return;
+  }
+  if (fd_a == fd_b) {
+    status_ = status_t::InvalidArgument;
+    return;
+  }
+  // libserialport waits for readiness itself, so it is not bothered by this
+  for (const auto fd : {fd_a, fd_b}) {
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+  }
+  // the capture sinks are never waited for
+  for (const auto fd : {options.capture_a_to_b, options.capture_b_to_a}) {
+    if (fd >= 0) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+  }
+
+  a_to_b_ = std::make_unique<lane>(fd_a, fd_b, options.capture_a_to_b,
+                                   options.use_splice);
+  b_to_a_ = std::make_unique<lane>(fd_b, fd_a, options.capture_b_to_a,
+                                   options.use_splice);
+  wakeup_fd_ = eventfd(0U, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (wakeup_fd_ < 0) {
+    status_ = status_t::SystemError;
+    return;
+  }
+  relay_ = std::jthread{[this](const std::stop_token &stop) { run(stop); }};
+#else
+  (void)a;
+  (void)b;
+  (void)options;
+  status_ = status_t::NotSupported;
+#endif
+}
+
+sp::bridge::~bridge() {
+  // the lanes and the eventfd must outlive the relay
+  relay_.request_stop();
+  if (relay_.joinable()) {
+    relay_.join();
+  }
+#ifdef __linux__
+  if (wakeup_fd_ >= 0) {
+    close(wakeup_fd_);
+  }
+#endif
+}
+
+bool sp::bridge::is_zero_copy() const noexcept {
+  return a_to_b_ && a_to_b_->spliced && b_to_a_->spliced;
+}
+
+sp::bridge_stats_t sp::bridge::get_stats() const noexcept {
+  if (!a_to_b_) {
+    return {};
+  }
+  return {.a_to_b = a_to_b_->relayed,
+          .b_to_a = b_to_a_->relayed,
+          .dropped_a_to_b = a_to_b_->dropped,
+          .dropped_b_to_a = b_to_a_->dropped};
+}
+
+sp::status_t sp::bridge::get_status() const noexcept { return status_; }
+
+void sp::bridge::run([[maybe_unused]] const std::stop_token &stop) {
+#ifdef __linux__
+  const auto on_stop = std::stop_callback{stop, [this] {
+    const auto one = std::uint64_t{1};
+    (void)write(wakeup_fd_, &one, sizeof(one));
+  }};
+
+  const auto epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd < 0) {
+    status_ = status_t::SystemError;
+    return;
+  }
+  const auto fd_a = a_to_b_->src;
+  const auto fd_b = b_to_a_->src;
+  auto event = epoll_event{.events = EPOLLIN, .data = {.fd = wakeup_fd_}};
+  epoll_ctl(epoll_fd, EPOLL_CTL_ADD, wakeup_fd_, &event);
+  // the events of interest for each port, which are updated as data becomes
+  // pending in either direction
+  auto interest = std::array<std::uint32_t, 2>{EPOLLIN, EPOLLIN};
+  for (const auto fd : {fd_a, fd_b}) {
+    event = epoll_event{.events = EPOLLIN, .data = {.fd = fd}};
+    epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event);
+  }
+
+  // readiness as last reported, `0` for port a and `1` for port b
+  auto readable = std::array<bool, 2>{true, true};
+  auto writable = std::array<bool, 2>{false, false};
+  auto events = std::array<epoll_event, 3>{};
+
+  const auto relay = [](lane &l, bool &src_readable, bool &dst_writable) {
+    if (l.pending == 0U && src_readable) {
+      if (!l.fill()) {
+        return false;
+      }
+      src_readable = false;
+      dst_writable = true; // as far as is known
+    }
+    if (l.pending > 0U && dst_writable) {
+      if (!l.drain()) {
+        return false;
+      }
+      dst_writable = l.pending == 0U;
+    }
+    return true;
+  };
+
+  while (!stop.stop_requested()) {
+    if (!relay(*a_to_b_, readable[0], writable[1])
+        || !relay(*b_to_a_, readable[1], writable[0])) {
+      status_ = status_t::SystemError;
+      break;
+    }
+
+    const auto wanted = std::array<std::uint32_t, 2>{
+        (a_to_b_->pending == 0U ? EPOLLIN : 0U)
+            | (b_to_a_->pending > 0U ? EPOLLOUT : 0U),
+        (b_to_a_->pending == 0U ? EPOLLIN : 0U)
+            | (a_to_b_->pending > 0U ? EPOLLOUT : 0U)};
+    for (auto i = 0U; i < wanted.size(); ++i) {
+      if (wanted[i] != interest[i]) {
+        interest[i] = wanted[i];
+        const auto fd = i == 0U ? fd_a : fd_b;
+        event = epoll_event{.events = wanted[i], .data = {.fd = fd}};
+        epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &event);
+      }
+    }
+
+    const auto count =
+        epoll_wait(epoll_fd, events.data(), events.size(), -1);
+    if (count < 0 && errno != EINTR) {
+      status_ = status_t::SystemError;
+      break;
+    }
+    for (auto i = 0; i < count; ++i) {
+      const auto &ev = events[static_cast<std::size_t>(i)];
+      if (ev.data.fd == wakeup_fd_) {
+        continue;
+      }
+      const auto side = ev.data.fd == fd_a ? 0U : 1U;
+      // a hangup or error is noticed by attempting to read
+      if ((ev.events & (EPOLLIN | EPOLLHUP | EPOLLERR)) != 0U) {
+        readable[side] = true;
+      }
+      if ((ev.events & EPOLLOUT) != 0U) {
+        writable[side] = true;
+      }
+    }
+  }
+  close(epoll_fd);
+#endif
+}
@@ -0,0 +1,39 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Opens and configures many ports at once.
+
+#include <spp/bulk_open.hpp>
+
+#include "for_each_parallel.hpp"
+
+#include <cstddef>
+#include <exception>
+
+namespace {
+  void open_one(const sp::port_t &port, const sp::mode_t mode,
+                const sp::port_config_t &cfg, sp::open_result_t &result) {
+    try {
+      auto conn = sp::connection{port, mode};
+      result.status = conn.set_config(cfg);
+      if (result.status == sp::status_t::OK) {
+        result.conn.emplace(std::move(conn));
+      }
+    } catch (const sp::connection_exc &) {
+      result.status = sp::get_status();
+    } catch (const std::exception &) {
+      result.status = sp::status_t::SystemError;
+    }
+  }
+} // namespace
+
+std::vector<sp::open_result_t> sp::open_all(const std::span<const port_t> ports,
+                                            const mode_t mode,
+                                            const port_config_t &cfg,
+                                            const unsigned max_workers) {
+  auto results = std::vector<open_result_t>(ports.size());
+  detail::for_each_parallel(ports.size(), max_workers,
+                            [&](const std::size_t i) {
+                              open_one(ports[i], mode, cfg, results[i]);
+                            });
+  return results;
+}
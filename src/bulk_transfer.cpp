@@ -0,0 +1,1245 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Transfers files through XMODEM-1K, YMODEM and ZMODEM.
+
+#include <spp/bulk_transfer.hpp>
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <string_view>
+#include <utility>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  using sp::transfer_error_t;
+
+  constexpr auto crc_table = [] {
+    auto table = std::array<std::uint16_t, 256>{};
+    for (auto i = 0U; i < table.size(); ++i) {
+      auto crc = static_cast<std::uint16_t>(i << 8U);
+      for (auto bit = 0; bit < 8; ++bit) {
+        crc = static_cast<std::uint16_t>(
+            (crc & 0x8000U) != 0U ? (crc << 1U) ^ 0x1021U : crc << 1U);
+      }
+      table[i] = crc;
+    }
+    return table;
+  }();
+
+  constexpr auto soh = std::byte{0x01};
+  constexpr auto stx = std::byte{0x02};
+  constexpr auto eot = std::byte{0x04};
+  constexpr auto ack = std::byte{0x06};
+  constexpr auto backspace = std::byte{0x08};
+  constexpr auto nak = std::byte{0x15};
+  constexpr auto can = std::byte{0x18};
+  constexpr auto sub = std::byte{0x1a};
+  constexpr auto crc_request = std::byte{'C'};
+  constexpr auto streaming_request = std::byte{'G'};
+
+  constexpr auto block_size = std::size_t{1'024};
+  constexpr auto short_block_size = std::size_t{128};
+
+  // results of reading other than a byte
+  constexpr auto got_timeout = -1;
+  constexpr auto got_error = -2;
+  constexpr auto got_cancel = -3;
+  constexpr auto got_garbage = -4;
+
+  // collects what arrives, so that it can be taken byte by byte
+  class rx_buffer {
+   public:
+    explicit rx_buffer(sp::connection &conn) : conn_{&conn} {}
+
+    // returns the next byte, or `got_timeout` or `got_error`
+    // a negative timeout returns at once
+    int get(const long timeout_ms) {
+      if (pos_ == len_) {
+        const auto ret = fill(timeout_ms);
+        if (ret <= 0) {
+          return ret < 0 ? got_error : got_timeout;
+        }
+      }
+      return std::to_integer<int>(buf_[pos_++]);
+    }
+
+    // drops what has arrived, e.g. the rest of a damaged block
+    void discard() {
+      pos_ = len_ = 0U;
+      while (fill(-1) > 0) {
+      }
+      pos_ = len_ = 0U;
+    }
+
+   private:
+    int fill(const long timeout_ms) {
+      const auto size = static_cast<int>(buf_.size());
+      const auto ret =
+          timeout_ms < 0
+              ? conn_->read_nonblocking(buf_.data(), size)
+              : conn_->read_next_blocking(buf_.data(), size, timeout_ms);
+      if (ret > 0) {
+        pos_ = 0U;
+        len_ = static_cast<std::size_t>(ret);
+      }
+      return ret;
+    }
+
+    sp::connection *conn_;
+    std::array<std::byte, 4'096> buf_{};
+    std::size_t pos_{0U};
+    std::size_t len_{0U};
+  };
+
+  // the state shared by all protocols
+  struct session {
+    session(sp::connection &c, const sp::transfer_options_t &o)
+        : conn{c}, rx{c}, options{o} {}
+
+    bool send(const std::span<const std::byte> data) {
+      const auto count = static_cast<int>(data.size());
+      const auto ret =
+          conn.write_blocking(data.data(), count, options.timeout_ms);
+      if (ret != count) {
+        result.error =
+            ret < 0 ? transfer_error_t::Port : transfer_error_t::Timeout;
+        return false;
+      }
+      return true;
+    }
+
+    bool send(const std::byte b) {
+      return send(std::span{&b, 1U});
+    }
+
+    int get() {
+      return rx.get(options.timeout_ms);
+    }
+
+    // tells the other side to stop
+    void cancel() {
+      auto sequence = std::array<std::byte, 16>{};
+      std::fill_n(sequence.begin(), 8, can);
+      std::fill_n(sequence.begin() + 8, 8, backspace);
+      conn.write_blocking(sequence.data(), static_cast<int>(sequence.size()),
+                          options.timeout_ms);
+    }
+
+    // records `error`, and cancels unless the other side has stopped already
+    sp::transfer_result_t fail(const transfer_error_t error) {
+      if (result.error == transfer_error_t::None) {
+        result.error = error;
+      }
+      if (result.error != transfer_error_t::Cancelled
+          && result.error != transfer_error_t::Port) {
+        cancel();
+      }
+      return std::move(result);
+    }
+
+    // maps the result of reading that is not a byte to an error
+    sp::transfer_result_t fail_on(const int got) {
+      return fail(got == got_error    ? transfer_error_t::Port
+                  : got == got_cancel ? transfer_error_t::Cancelled
+                  : got == got_timeout ? transfer_error_t::Timeout
+                                       : transfer_error_t::TooManyErrors);
+    }
+
+    void progress(const std::uint64_t position,
+                  const std::uint64_t size) const {
+      if (options.on_progress) {
+        options.on_progress(position, size);
+      }
+    }
+
+    sp::connection &conn;
+    rx_buffer rx;
+    const sp::transfer_options_t &options;
+    sp::transfer_result_t result;
+  };
+
+  std::string_view as_chars(const std::span<const std::byte> data) {
+    return {reinterpret_cast<const char *>(data.data()), data.size()};
+  }
+
+  std::span<const std::byte> as_bytes(const std::string_view s) {
+    return std::as_bytes(std::span{s.data(), s.size()});
+  }
+
+  // parses the decimal number at the start of `s`
+  std::uint64_t parse_size(const std::string_view s) {
+    auto size = std::uint64_t{0U};
+    std::from_chars(s.data(), s.data() + s.size(), size);
+    return size;
+  }
+
+  // --- XMODEM-1K and YMODEM ------------------------------------------------
+
+  // frames a block of `size` bytes, padding what `data` does not fill
+  void build_block(std::vector<std::byte> &frame, const std::uint8_t number,
+                   const std::span<const std::byte> data,
+                   const std::size_t size, const std::byte padding) {
+    frame.clear();
+    frame.push_back(size == block_size ? stx : soh);
+    frame.push_back(std::byte{number});
+    frame.push_back(std::byte{static_cast<std::uint8_t>(~number)});
+    frame.insert(frame.end(), data.begin(), data.end());
+    frame.resize(3U + size, padding);
+    const auto crc =
+        sp::crc16{}.update(std::span{frame}.subspan(3U)).value();
+    frame.push_back(std::byte{static_cast<std::uint8_t>(crc >> 8U)});
+    frame.push_back(std::byte{static_cast<std::uint8_t>(crc)});
+  }
+
+  // frames block 0 of YMODEM, which carries the name and size of the file,
+  // or nothing at the end of a batch
+  void build_header_block(std::vector<std::byte> &frame,
+                          const std::string_view name,
+                          const std::uint64_t size) {
+    auto info = std::string{};
+    if (!name.empty()) {
+      info.append(name).push_back('\0');
+      info.append(std::to_string(size));
+    }
+    build_block(frame, 0U, as_bytes(info),
+                info.size() < short_block_size ? short_block_size : block_size,
+                std::byte{0});
+  }
+
+  // waits for the receiver to ask for a block, returning the request or a
+  // negative result
+  int await_request(session &s) {
+    auto timeouts = 0;
+    while (true) {
+      const auto c = s.get();
+      if (c == got_timeout) {
+        if (++timeouts > s.options.max_retries) {
+          return got_timeout;
+        }
+      } else if (c < 0) {
+        return c;
+      } else if (std::byte(c) == crc_request
+                 || std::byte(c) == streaming_request) {
+        return c;
+      } else if (std::byte(c) == can && std::byte(s.get()) == can) {
+        return got_cancel;
+      }
+      // a NAK would ask for checksums instead of CRCs, which receivers
+      // only fall back to after asking for CRCs repeatedly
+    }
+  }
+
+  // waits for the receiver to acknowledge a block, returning `ack`, `nak`
+  // or a negative result
+  int await_reply(session &s) {
+    while (true) {
+      const auto c = s.get();
+      if (c < 0) {
+        return c;
+      }
+      if (std::byte(c) == ack || std::byte(c) == nak) {
+        return c;
+      }
+      if (std::byte(c) == can && std::byte(s.get()) == can) {
+        return got_cancel;
+      }
+    }
+  }
+
+  // sends `frame` until it is acknowledged
+  bool send_acknowledged(session &s, const std::vector<std::byte> &frame) {
+    for (auto attempt = 0; attempt <= s.options.max_retries; ++attempt) {
+      if (!s.send(frame)) {
+        return false;
+      }
+      const auto reply = await_reply(s);
+      if (reply >= 0 && std::byte(reply) == ack) {
+        return true;
+      }
+      if (reply == got_error || reply == got_cancel) {
+        s.fail_on(reply);
+        return false;
+      }
+    }
+    s.result.error = transfer_error_t::TooManyErrors;
+    return false;
+  }
+
+  sp::transfer_result_t send_xy(session &s,
+                                const std::span<const std::byte> data,
+                                const std::string_view name,
+                                const bool batch) {
+    auto request = await_request(s);
+    if (request < 0) {
+      return s.fail_on(request);
+    }
+    auto current = std::vector<std::byte>{};
+    auto next = std::vector<std::byte>{};
+    current.reserve(block_size + 5U);
+    next.reserve(block_size + 5U);
+
+    if (batch) {
+      build_header_block(current, name, data.size());
+      const auto sent = std::byte(request) == streaming_request
+                            ? s.send(current)
+                            : send_acknowledged(s, current);
+      if (!sent) {
+        return s.fail(s.result.error);
+      }
+      if ((request = await_request(s)) < 0) {
+        return s.fail_on(request);
+      }
+    }
+    const auto streaming = std::byte(request) == streaming_request;
+
+    const auto build = [&](std::vector<std::byte> &frame, std::size_t pos) {
+      const auto chunk =
+          data.subspan(pos, std::min(block_size, data.size() - pos));
+      const auto number = static_cast<std::uint8_t>(pos / block_size + 1U);
+      const auto size =
+          chunk.size() <= short_block_size ? short_block_size : block_size;
+      build_block(frame, number, chunk, size, sub);
+    };
+
+    auto pos = std::size_t{0U};
+    if (!data.empty()) {
+      build(current, 0U);
+    }
+    while (pos < data.size()) {
+      const auto chunk = std::min(block_size, data.size() - pos);
+      if (!s.send(current)) {
+        return s.fail(s.result.error);
+      }
+      s.result.bytes += chunk;
+      // the next block is framed while the receiver checks this one
+      if (pos + chunk < data.size()) {
+        build(next, pos + chunk);
+      }
+      if (streaming) {
+        // receivers stop a stream by cancelling it
+        const auto c = s.rx.get(-1);
+        if (c >= 0 && std::byte(c) == can) {
+          return s.fail(transfer_error_t::Cancelled);
+        }
+        if (c == got_error) {
+          return s.fail(transfer_error_t::Port);
+        }
+      } else {
+        auto attempt = 0;
+        auto reply = await_reply(s);
+        while (reply < 0 || std::byte(reply) != ack) {
+          if (reply == got_error || reply == got_cancel) {
+            return s.fail_on(reply);
+          }
+          if (++attempt > s.options.max_retries) {
+            return s.fail(transfer_error_t::TooManyErrors);
+          }
+          if (!s.send(current)) {
+            return s.fail(s.result.error);
+          }
+          s.result.bytes += chunk;
+          reply = await_reply(s);
+        }
+      }
+      pos += chunk;
+      s.progress(pos, data.size());
+      std::swap(current, next);
+    }
+
+    // YMODEM receivers NAK the first EOT to make sure that it is no noise
+    for (auto attempt = 0;; ++attempt) {
+      if (attempt > s.options.max_retries) {
+        return s.fail(transfer_error_t::TooManyErrors);
+      }
+      if (!s.send(eot)) {
+        return s.fail(s.result.error);
+      }
+      const auto reply = await_reply(s);
+      if (reply >= 0 && std::byte(reply) == ack) {
+        break;
+      }
+      if (reply == got_error || reply == got_cancel) {
+        return s.fail_on(reply);
+      }
+    }
+
+    if (batch) {
+      if ((request = await_request(s)) < 0) {
+        return s.fail_on(request);
+      }
+      build_header_block(current, {}, 0U);
+      if (streaming ? !s.send(current) : !send_acknowledged(s, current)) {
+        return s.fail(s.result.error);
+      }
+    }
+    return std::move(s.result);
+  }
+
+  // what `read_block` has read
+  struct block_t {
+    int kind; // `soh` for any block, `eot`, or a negative result
+    std::uint8_t number;
+  };
+
+  // reads a block into `payload`
+  block_t read_block(session &s, std::vector<std::byte> &payload) {
+    while (true) {
+      const auto c = s.get();
+      if (c < 0) {
+        return {c, 0U};
+      }
+      if (std::byte(c) == eot) {
+        return {c, 0U};
+      }
+      if (std::byte(c) == can) {
+        if (std::byte(s.get()) == can) {
+          return {got_cancel, 0U};
+        }
+        continue;
+      }
+      if (std::byte(c) != soh && std::byte(c) != stx) {
+        continue;
+      }
+      const auto size = std::byte(c) == stx ? block_size : short_block_size;
+      const auto number = s.get();
+      const auto complement = s.get();
+      payload.resize(size);
+      for (auto &b : payload) {
+        const auto d = s.get();
+        if (d < 0) {
+          return {d == got_error ? got_error : got_garbage, 0U};
+        }
+        b = std::byte(d);
+      }
+      const auto high = s.get();
+      const auto low = s.get();
+      if (number < 0 || complement < 0 || high < 0 || low < 0) {
+        return {got_error, 0U};
+      }
+      const auto crc = sp::crc16{}.update(payload).value();
+      if ((number ^ complement) != 0xff || crc != (high << 8 | low)) {
+        return {got_garbage, 0U};
+      }
+      return {std::to_integer<int>(soh), static_cast<std::uint8_t>(number)};
+    }
+  }
+
+  // reads block 0 of YMODEM, asking for it with `request`
+  block_t read_header_block(session &s, std::vector<std::byte> &payload,
+                            const std::byte request) {
+    for (auto attempt = 0; attempt <= s.options.max_retries; ++attempt) {
+      if (!s.send(request)) {
+        return {got_error, 0U};
+      }
+      const auto block = read_block(s, payload);
+      if (block.kind == std::to_integer<int>(soh) && block.number == 0U) {
+        return block;
+      }
+      if (block.kind == got_error || block.kind == got_cancel) {
+        return block;
+      }
+      s.rx.discard();
+    }
+    return {got_timeout, 0U};
+  }
+
+  sp::transfer_result_t receive_xy(session &s, std::vector<std::byte> &data,
+                                   const bool batch) {
+    const auto streaming = batch && s.options.streaming;
+    const auto request = streaming ? streaming_request : crc_request;
+    auto payload = std::vector<std::byte>{};
+    data.clear();
+
+    auto size = std::uint64_t{0U};
+    auto has_size = false;
+    if (batch) {
+      const auto block = read_header_block(s, payload, request);
+      if (block.kind < 0) {
+        return s.fail_on(block.kind);
+      }
+      const auto info = as_chars(payload);
+      s.result.name = info.substr(0U, info.find('\0'));
+      if (s.result.name.empty()) {
+        // the batch is empty
+        s.send(ack);
+        return std::move(s.result);
+      }
+      const auto rest = info.substr(s.result.name.size() + 1U);
+      has_size = !rest.empty() && rest.front() >= '0' && rest.front() <= '9';
+      size = parse_size(rest);
+      if (!streaming && !s.send(ack)) {
+        return s.fail(s.result.error);
+      }
+    }
+
+    auto expected = std::uint8_t{1U};
+    auto errors = 0;
+    auto eots = 0;
+    auto started = false;
+    if (!s.send(request)) {
+      return s.fail(s.result.error);
+    }
+    while (true) {
+      const auto block = read_block(s, payload);
+      if (block.kind == got_error || block.kind == got_cancel) {
+        return s.fail_on(block.kind);
+      }
+      if (block.kind < 0) {
+        // streams cannot be recovered
+        if (streaming || ++errors > s.options.max_retries) {
+          return s.fail(block.kind == got_timeout
+                            ? transfer_error_t::Timeout
+                            : transfer_error_t::TooManyErrors);
+        }
+        s.rx.discard();
+        // keep asking until the sender starts
+        if (!s.send(started ? nak : request)) {
+          return s.fail(s.result.error);
+        }
+        continue;
+      }
+      if (std::byte(block.kind) == eot) {
+        if (batch && eots++ == 0) {
+          s.send(nak);
+          continue;
+        }
+        s.send(ack);
+        break;
+      }
+      started = true;
+      errors = 0;
+      if (block.number == expected) {
+        data.insert(data.end(), payload.begin(), payload.end());
+        s.result.bytes += payload.size();
+        ++expected;
+        s.progress(data.size(), size);
+      } else if (block.number != static_cast<std::uint8_t>(expected - 1U)) {
+        return s.fail(transfer_error_t::Protocol);
+      }
+      if (!streaming && !s.send(ack)) {
+        return s.fail(s.result.error);
+      }
+    }
+
+    if (batch) {
+      if (has_size && size < data.size()) {
+        data.resize(static_cast<std::size_t>(size));
+      }
+      // only one file is received, the rest of a batch is cancelled
+      const auto block = read_header_block(s, payload, request);
+      if (block.kind < 0) {
+        return s.fail_on(block.kind);
+      }
+      if (payload.front() != std::byte{0}) {
+        s.cancel();
+      } else {
+        s.send(ack);
+      }
+    }
+    return std::move(s.result);
+  }
+
+  // --- ZMODEM --------------------------------------------------------------
+
+  namespace zmodem {
+    constexpr auto zpad = std::byte{'*'};
+    constexpr auto zdle = std::byte{0x18};
+    constexpr auto zbin = std::byte{'A'};
+    constexpr auto zhex = std::byte{'B'};
+    constexpr auto xon = std::byte{0x11};
+
+    // ends of subpackets
+    constexpr auto zcrce = std::byte{'h'}; // end of frame
+    constexpr auto zcrcg = std::byte{'i'}; // frame continues
+    constexpr auto zcrcq = std::byte{'j'}; // frame continues, ZACK expected
+    constexpr auto zcrcw = std::byte{'k'}; // end of frame, ZACK expected
+
+    // flags of ZRINIT
+    constexpr auto canfdx = std::uint8_t{0x01};
+    constexpr auto canovio = std::uint8_t{0x02};
+
+    enum class frame_t : std::uint8_t {
+      RqInit = 0,
+      RInit = 1,
+      SInit = 2,
+      Ack = 3,
+      File = 4,
+      Skip = 5,
+      Nak = 6,
+      Abort = 7,
+      Fin = 8,
+      RPos = 9,
+      Data = 10,
+      Eof = 11,
+      Challenge = 14
+    };
+
+    struct header_t {
+      frame_t type{frame_t::RqInit};
+      std::array<std::uint8_t, 4> data{};
+
+      std::uint32_t position() const {
+        return std::uint32_t{data[0]} | std::uint32_t{data[1]} << 8U
+               | std::uint32_t{data[2]} << 16U | std::uint32_t{data[3]} << 24U;
+      }
+    };
+
+    header_t make_header(const frame_t type, const std::uint32_t position) {
+      return {type,
+              {static_cast<std::uint8_t>(position),
+               static_cast<std::uint8_t>(position >> 8U),
+               static_cast<std::uint8_t>(position >> 16U),
+               static_cast<std::uint8_t>(position >> 24U)}};
+    }
+
+    void append_escaped(std::vector<std::byte> &out, const std::byte b) {
+      switch (std::to_integer<unsigned>(b)) {
+      case 0x18U: // ZDLE
+      case 0x10U: // DLE
+      case 0x90U:
+      case 0x11U: // XON
+      case 0x91U:
+      case 0x13U: // XOFF
+      case 0x93U:
+        out.push_back(zdle);
+        out.push_back(b ^ std::byte{0x40});
+        break;
+      default:
+        out.push_back(b);
+      }
+    }
+
+    void append_crc(std::vector<std::byte> &out, const std::uint16_t crc) {
+      append_escaped(out, std::byte{static_cast<std::uint8_t>(crc >> 8U)});
+      append_escaped(out, std::byte{static_cast<std::uint8_t>(crc)});
+    }
+
+    bool send_hex_header(session &s, const header_t &h) {
+      constexpr auto digits = std::string_view{"0123456789abcdef"};
+      auto raw = std::array<std::byte, 5>{
+          std::byte{static_cast<std::uint8_t>(h.type)}};
+      std::transform(h.data.begin(), h.data.end(), raw.begin() + 1,
+                     [](const auto b) { return std::byte{b}; });
+      const auto crc = sp::crc16{}.update(raw).value();
+      auto frame = std::string{"**\x18" "B"};
+      const auto append_hex = [&](const unsigned b) {
+        frame.push_back(digits[b >> 4U]);
+        frame.push_back(digits[b & 0x0fU]);
+      };
+      for (const auto b : raw) {
+        append_hex(std::to_integer<unsigned>(b));
+      }
+      append_hex(crc >> 8U);
+      append_hex(crc & 0xffU);
+      frame += "\r\x8a";
+      if (h.type != frame_t::Ack && h.type != frame_t::Fin) {
+        frame.push_back(static_cast<char>(xon));
+      }
+      return s.send(as_bytes(frame));
+    }
+
+    void append_binary_header(std::vector<std::byte> &out, const header_t &h) {
+      auto crc = sp::crc16{};
+      out.push_back(zpad);
+      out.push_back(zdle);
+      out.push_back(zbin);
+      const auto type = std::byte{static_cast<std::uint8_t>(h.type)};
+      append_escaped(out, type);
+      crc.update(std::span{&type, 1U});
+      for (const auto b : h.data) {
+        const auto d = std::byte{b};
+        append_escaped(out, d);
+        crc.update(std::span{&d, 1U});
+      }
+      append_crc(out, crc.value());
+    }
+
+    void append_subpacket(std::vector<std::byte> &out,
+                          const std::span<const std::byte> data,
+                          const std::byte end) {
+      for (const auto b : data) {
+        append_escaped(out, b);
+      }
+      out.push_back(zdle);
+      out.push_back(end);
+      append_crc(out, sp::crc16{}.update(data).update({&end, 1U}).value());
+    }
+
+    // returns the next byte, unescaped, the end of a subpacket as `0x100`
+    // plus the character, or a negative result
+    int get_escaped(session &s) {
+      auto c = 0;
+      do {
+        c = s.get();
+        // flow control characters are escaped, so they are noise
+      } while (c == 0x11 || c == 0x13 || c == 0x91 || c == 0x93);
+      if (c < 0 || std::byte(c) != zdle) {
+        return c;
+      }
+      for (auto cancels = 1;;) {
+        const auto d = s.get();
+        if (d < 0) {
+          return d;
+        }
+        if (std::byte(d) == zdle) {
+          // five CANs in a row abort a session
+          if (++cancels == 5) {
+            return got_cancel;
+          }
+          continue;
+        }
+        if (d >= 'h' && d <= 'k') {
+          return 0x100 | d;
+        }
+        if (d == 'l') {
+          return 0x7f;
+        }
+        if (d == 'm') {
+          return 0xff;
+        }
+        if ((d & 0x60) == 0x40) {
+          return d ^ 0x40;
+        }
+        return got_garbage;
+      }
+    }
+
+    int parse_hex(const int c) {
+      return c >= '0' && c <= '9'   ? c - '0'
+             : c >= 'a' && c <= 'f' ? c - 'a' + 10
+                                    : -1;
+    }
+
+    // reads the next header into `h`, returning `0` or a negative result
+    // unless `wait` is set, returns `got_timeout` rather than waiting for a
+    // header to begin
+    int read_header(session &s, header_t &h, const bool wait = true) {
+      auto raw = std::array<std::uint8_t, 7>{};
+      auto cancels = 0;
+      while (true) {
+        auto c = wait ? s.get() : s.rx.get(-1);
+        if (c < 0) {
+          return c;
+        }
+        if (std::byte(c) == can) {
+          if (++cancels == 5) {
+            return got_cancel;
+          }
+          continue;
+        }
+        cancels = 0;
+        if (std::byte(c) != zpad) {
+          continue;
+        }
+        do {
+          c = s.get();
+        } while (c >= 0 && std::byte(c) == zpad);
+        if (c < 0 || std::byte(c) != zdle) {
+          continue;
+        }
+        const auto format = s.get();
+        if (format >= 0 && std::byte(format) == zbin) {
+          for (auto &b : raw) {
+            const auto d = get_escaped(s);
+            if (d < 0 || d > 0xff) {
+              return d == got_error || d == got_cancel ? d : got_garbage;
+            }
+            b = static_cast<std::uint8_t>(d);
+          }
+        } else if (format >= 0 && std::byte(format) == zhex) {
+          for (auto &b : raw) {
+            const auto high = parse_hex(s.get());
+            const auto low = parse_hex(s.get());
+            if (high < 0 || low < 0) {
+              return got_garbage;
+            }
+            b = static_cast<std::uint8_t>(high << 4 | low);
+          }
+        } else {
+          continue;
+        }
+        const auto crc =
+            sp::crc16{}.update(std::as_bytes(std::span{raw}.first(5U))).value();
+        if (crc != (raw[5] << 8 | raw[6])) {
+          return got_garbage;
+        }
+        h.type = static_cast<frame_t>(raw[0]);
+        std::copy_n(raw.begin() + 1, 4, h.data.begin());
+        return 0;
+      }
+    }
+
+    // reads a subpacket into `data`, returning its end or a negative result
+    int read_subpacket(session &s, std::vector<std::byte> &data) {
+      data.clear();
+      while (true) {
+        const auto c = get_escaped(s);
+        if (c < 0) {
+          return c;
+        }
+        if (c <= 0xff) {
+          if (data.size() == 8U * block_size) {
+            return got_garbage;
+          }
+          data.push_back(std::byte(c));
+          continue;
+        }
+        const auto end = std::byte(c & 0xff);
+        const auto high = get_escaped(s);
+        const auto low = get_escaped(s);
+        if (high < 0 || low < 0 || high > 0xff || low > 0xff) {
+          return high == got_error || low == got_error ? got_error
+                                                       : got_garbage;
+        }
+        const auto crc = sp::crc16{}.update(data).update({&end, 1U}).value();
+        if (crc != (high << 8 | low)) {
+          return got_garbage;
+        }
+        return std::to_integer<int>(end);
+      }
+    }
+  } // namespace zmodem
+
+  sp::transfer_result_t send_z(session &s,
+                               const std::span<const std::byte> data,
+                               const std::string_view name) {
+    using namespace zmodem;
+    if (data.size() > UINT32_MAX) {
+      return s.fail(transfer_error_t::Protocol);
+    }
+    const auto size = static_cast<std::uint32_t>(data.size());
+    auto h = header_t{};
+
+    // starts the receiver, if it needs to be started
+    if (!s.send(as_bytes("rz\r")) || !send_hex_header(s, {})) {
+      return s.fail(s.result.error);
+    }
+    for (auto attempt = 0;;) {
+      const auto got = read_header(s, h);
+      if (got == 0 && h.type == frame_t::RInit) {
+        break;
+      }
+      if (got == 0 && h.type == frame_t::Challenge) {
+        send_hex_header(s, {frame_t::Ack, h.data});
+        continue;
+      }
+      if (got == got_error || got == got_cancel) {
+        return s.fail_on(got);
+      }
+      if (got == 0 && h.type == frame_t::RqInit) {
+        continue;
+      }
+      if (++attempt > s.options.max_retries) {
+        return s.fail_on(got);
+      }
+      send_hex_header(s, {});
+    }
+
+    auto frame = std::vector<std::byte>{};
+    frame.reserve(8U * block_size);
+    auto info = std::string{name};
+    info.push_back('\0');
+    info.append(std::to_string(size)).push_back('\0');
+    auto start = std::uint32_t{0U};
+    for (auto attempt = 0;;) {
+      frame.clear();
+      append_binary_header(frame, make_header(frame_t::File, 0U));
+      append_subpacket(frame, as_bytes(info), zcrcw);
+      if (!s.send(frame)) {
+        return s.fail(s.result.error);
+      }
+      auto got = read_header(s, h);
+      // the receiver may have answered ZRQINIT more than once
+      while (got == 0 && h.type == frame_t::RInit) {
+        got = read_header(s, h);
+      }
+      if (got == 0 && h.type == frame_t::RPos) {
+        start = h.position();
+        break;
+      }
+      if (got == 0 && h.type == frame_t::Skip) {
+        return std::move(s.result);
+      }
+      if (got == got_error || got == got_cancel) {
+        return s.fail_on(got);
+      }
+      if (++attempt > s.options.max_retries) {
+        return s.fail_on(got);
+      }
+    }
+    if (start > size) {
+      return s.fail(transfer_error_t::Protocol);
+    }
+    s.result.offset = start;
+
+    const auto window = s.options.window;
+    auto pos = start;
+    auto acknowledged = start;
+    auto retries = 0;
+    while (true) {
+      frame.clear();
+      append_binary_header(frame, make_header(frame_t::Data, pos));
+      auto queried = pos;
+      auto rewound = false;
+      while (pos < size && !rewound) {
+        const auto chunk = static_cast<std::uint32_t>(
+            std::min<std::size_t>(block_size, size - pos));
+        const auto next = pos + chunk;
+        const auto end = next == size                               ? zcrce
+                         : window > 0U && next - queried >= window / 2U ? zcrcq
+                                                                      : zcrcg;
+        if (end == zcrcq) {
+          queried = next;
+        }
+        append_subpacket(frame, data.subspan(pos, chunk), end);
+        s.result.bytes += chunk;
+        pos = next;
+        // subpackets are gathered into fewer writes
+        if (end == zcrcg && frame.size() < 4U * block_size) {
+          continue;
+        }
+        if (!s.send(frame)) {
+          return s.fail(s.result.error);
+        }
+        frame.clear();
+        s.progress(pos, size);
+
+        // the receiver's replies are handled as they come in, and waited for
+        // only once the window is full
+        while (true) {
+          const auto full = window > 0U && pos - acknowledged >= window;
+          const auto got = read_header(s, h, full);
+          if (got == got_timeout && !full) {
+            break;
+          }
+          if (got == got_error || got == got_cancel) {
+            return s.fail_on(got);
+          }
+          if (got == got_timeout) {
+            // the acknowledgement may have been lost, so what has not been
+            // acknowledged is sent again
+            if (++retries > s.options.max_retries) {
+              return s.fail_on(got);
+            }
+            pos = acknowledged;
+            s.rx.discard();
+            rewound = true;
+            break;
+          }
+          if (got < 0) {
+            continue;
+          }
+          if (h.type == frame_t::Ack) {
+            if (h.position() > acknowledged && h.position() <= pos) {
+              acknowledged = h.position();
+              retries = 0;
+            }
+          } else if (h.type == frame_t::RPos) {
+            if (h.position() > size || ++retries > s.options.max_retries) {
+              return s.fail(transfer_error_t::TooManyErrors);
+            }
+            pos = acknowledged = h.position();
+            s.rx.discard();
+            rewound = true;
+            break;
+          }
+        }
+      }
+      if (rewound) {
+        continue;
+      }
+
+      auto finished = false;
+      for (auto attempt = 0; !finished && !rewound;) {
+        frame.clear();
+        append_binary_header(frame, make_header(frame_t::Eof, size));
+        if (!s.send(frame)) {
+          return s.fail(s.result.error);
+        }
+        while (true) {
+          const auto got = read_header(s, h);
+          if (got == got_error || got == got_cancel) {
+            return s.fail_on(got);
+          }
+          if (got < 0) {
+            if (++attempt > s.options.max_retries) {
+              return s.fail_on(got);
+            }
+            break;
+          }
+          if (h.type == frame_t::RInit) {
+            finished = true;
+            break;
+          }
+          if (h.type == frame_t::RPos) {
+            if (h.position() > size || ++retries > s.options.max_retries) {
+              return s.fail(transfer_error_t::TooManyErrors);
+            }
+            pos = acknowledged = h.position();
+            rewound = true;
+            break;
+          }
+          // late acknowledgements are of no interest any longer
+        }
+      }
+      if (finished) {
+        break;
+      }
+    }
+
+    for (auto attempt = 0;;) {
+      if (!send_hex_header(s, {frame_t::Fin, {}})) {
+        return s.fail(s.result.error);
+      }
+      const auto got = read_header(s, h);
+      if (got == 0 && h.type == frame_t::Fin) {
+        break;
+      }
+      if (got == got_error || got == got_cancel) {
+        return s.fail_on(got);
+      }
+      if (got < 0 && ++attempt > s.options.max_retries) {
+        return s.fail_on(got);
+      }
+    }
+    s.send(as_bytes("OO"));
+    return std::move(s.result);
+  }
+
+  sp::transfer_result_t receive_z(session &s, std::vector<std::byte> &data) {
+    using namespace zmodem;
+    const auto rinit =
+        header_t{frame_t::RInit, {0U, 0U, 0U, canfdx | canovio}};
+    auto h = header_t{};
+    auto packet = std::vector<std::byte>{};
+    auto size = std::uint64_t{0U};
+    auto has_file = false;
+    auto errors = 0;
+
+    const auto position = [&] {
+      return static_cast<std::uint32_t>(data.size());
+    };
+    const auto request_position = [&] {
+      return send_hex_header(s, make_header(frame_t::RPos, position()));
+    };
+
+    if (!send_hex_header(s, rinit)) {
+      return s.fail(s.result.error);
+    }
+    while (true) {
+      const auto got = read_header(s, h);
+      if (got == got_error || got == got_cancel) {
+        return s.fail_on(got);
+      }
+      if (got < 0) {
+        if (++errors > s.options.max_retries) {
+          return s.fail_on(got);
+        }
+        if (!(has_file ? request_position() : send_hex_header(s, rinit))) {
+          return s.fail(s.result.error);
+        }
+        continue;
+      }
+
+      switch (h.type) {
+      case frame_t::RqInit:
+        send_hex_header(s, rinit);
+        break;
+      case frame_t::SInit:
+        // the attention string is of no use here
+        if (read_subpacket(s, packet) >= 0) {
+          send_hex_header(s, {frame_t::Ack, {}});
+        }
+        break;
+      case frame_t::File: {
+        if (read_subpacket(s, packet) < 0) {
+          send_hex_header(s, rinit);
+          break;
+        }
+        const auto info = as_chars(packet);
+        s.result.name = info.substr(0U, info.find('\0'));
+        size = parse_size(info.substr(std::min(info.size(),
+                                               s.result.name.size() + 1U)));
+        // what is there cannot be the beginning of this file
+        if (data.size() > size) {
+          data.clear();
+        }
+        s.result.offset = data.size();
+        has_file = true;
+        request_position();
+        break;
+      }
+      case frame_t::Data: {
+        if (!has_file) {
+          send_hex_header(s, rinit);
+          break;
+        }
+        if (h.position() != data.size()) {
+          // the rest of the frame is skipped as garbage
+          s.rx.discard();
+          request_position();
+          break;
+        }
+        auto end = 0;
+        do {
+          end = read_subpacket(s, packet);
+          if (end == got_error || end == got_cancel) {
+            return s.fail_on(end);
+          }
+          if (end < 0) {
+            if (++errors > s.options.max_retries) {
+              return s.fail(transfer_error_t::TooManyErrors);
+            }
+            s.rx.discard();
+            request_position();
+            break;
+          }
+          errors = 0;
+          data.insert(data.end(), packet.begin(), packet.end());
+          s.result.bytes += packet.size();
+          s.progress(data.size(), size);
+          if (std::byte(end) == zcrcq || std::byte(end) == zcrcw) {
+            send_hex_header(s, make_header(frame_t::Ack, position()));
+          }
+        } while (std::byte(end) == zcrcg || std::byte(end) == zcrcq);
+        break;
+      }
+      case frame_t::Eof:
+        // an EOF that overtook data that has been asked for again is stale
+        if (h.position() == data.size()) {
+          send_hex_header(s, rinit);
+        }
+        break;
+      case frame_t::Fin:
+        send_hex_header(s, {frame_t::Fin, {}});
+        // the sender's "OO" ends the session, it is not waited for
+        s.rx.discard();
+        return std::move(s.result);
+      case frame_t::Abort:
+        return s.fail(transfer_error_t::Cancelled);
+      default:
+        break;
+      }
+    }
+  }
+
+#ifndef _WIN32
+  // maps a file for reading it from start to end
+  class mapped_file {
+   public:
+    explicit mapped_file(const char *const path) {
+      const auto fd = open(path, O_RDONLY | O_CLOEXEC);
+      if (fd < 0) {
+        return;
+      }
+      struct stat st {};
+      if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_ == 0U) {
+          valid_ = true;
+        } else if (auto *const addr =
+                       mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                   addr != MAP_FAILED) {
+          madvise(addr, size_, MADV_SEQUENTIAL);
+          addr_ = addr;
+          valid_ = true;
+        }
+      }
+      // the mapping outlives the file descriptor
+      close(fd);
+    }
+
+    ~mapped_file() {
+      if (addr_ != nullptr) {
+        munmap(addr_, size_);
+      }
+    }
+
+    mapped_file(const mapped_file &) = delete;
+    mapped_file &operator=(const mapped_file &) = delete;
+
+    bool is_valid() const {
+      return valid_;
+    }
+
+    std::span<const std::byte> data() const {
+      return {static_cast<const std::byte *>(addr_), addr_ ? size_ : 0U};
+    }
+
+   private:
+    void *addr_{nullptr};
+    std::size_t size_{0U};
+    bool valid_{false};
+  };
+#endif
+} // namespace
+
+sp::crc16 &sp::crc16::update(const std::span<const std::byte> data) noexcept {
+  for (const auto b : data) {
+    const auto index = (value_ >> 8U) ^ std::to_integer<unsigned>(b);
+    value_ = static_cast<std::uint16_t>((value_ << 8U) ^ crc_table[index]);
+  }
+  return *this;
+}
+
+sp::transfer_result_t sp::send(connection &conn,
+                               const std::span<const std::byte> data,
+                               const char *const name,
+                               const transfer_options_t &options) {
+  auto s = session{conn, options};
+  // an empty name would end a batch of YMODEM
+  const auto file_name =
+      std::string_view{name != nullptr && *name != '\0' ? name : "data"};
+  switch (options.protocol) {
+  case transfer_protocol_t::XModem1K:
+    return send_xy(s, data, file_name, false);
+  case transfer_protocol_t::YModem:
+    return send_xy(s, data, file_name, true);
+  case transfer_protocol_t::ZModem:
+    return send_z(s, data, file_name);
+  }
+  return s.fail(transfer_error_t::Protocol);
+}
+
+sp::transfer_result_t sp::send_file(connection &conn, const char *const path,
+                                    const transfer_options_t &options) {
+#ifndef _WIN32
+  if (path != nullptr) {
+    const auto file = mapped_file{path};
+    if (file.is_valid()) {
+      const auto name = std::string_view{path};
+      const auto slash = name.rfind('/');
+      const auto base = std::string{
+          slash == std::string_view::npos ? name : name.substr(slash + 1U)};
+      return send(conn, file.data(), base.c_str(), options);
+    }
+  }
+#else
+  (void)conn;
+  (void)path;
+  (void)options;
+#endif
+  return {transfer_error_t::File, 0U, 0U, {}};
+}
+
+sp::transfer_result_t sp::receive(connection &conn,
+                                  std::vector<std::byte> &data,
+                                  const transfer_options_t &options) {
+  auto s = session{conn, options};
+  switch (options.protocol) {
+  case transfer_protocol_t::XModem1K:
+    return receive_xy(s, data, false);
+  case transfer_protocol_t::YModem:
+    return receive_xy(s, data, true);
+  case transfer_protocol_t::ZModem:
+    return receive_z(s, data);
+  }
+  return s.fail(transfer_error_t::Protocol);
+}
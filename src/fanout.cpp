@@ -0,0 +1,93 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Writes the same data to many connections at once.
+
+#include <spp/fanout.hpp>
+
+#include <libserialport.h>
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+  using std::chrono::steady_clock;
+} // namespace
+
+sp::payload_t sp::make_payload(const std::span<const std::byte> data) {
+  return std::make_shared<const std::vector<std::byte>>(data.begin(),
+                                                        data.end());
+}
+
+std::vector<sp::fanout_result_t>
+sp::write_all(const std::span<connection *const> conns, const payload_t payload,
+              const long timeout_ms) {
+  auto results = std::vector<fanout_result_t>(conns.size(),
+                                              {0, status_t::OK});
+  if (timeout_ms < 0 || !payload) {
+    std::ranges::fill(results, fanout_result_t{0, status_t::InvalidArgument});
+    return results;
+  }
+  const auto size = static_cast<int>(payload->size());
+  const auto deadline =
+      steady_clock::now() + std::chrono::milliseconds{timeout_ms};
+
+  // indices of the ports that still take part
+  auto active = std::vector<std::size_t>{};
+  active.reserve(conns.size());
+  for (auto i = 0U; i < conns.size(); ++i) {
+    if (conns[i] == nullptr) {
+      results[i].status = status_t::InvalidArgument;
+    } else if (size > 0) { // an empty payload is written as it is
+      active.push_back(i);
+    }
+  }
+
+  while (true) {
+    std::erase_if(active, [&](const std::size_t i) {
+      auto &result = results[i];
+      const auto ret = conns[i]->write_nonblocking(
+          payload->data() + result.written, size - result.written);
+      if (ret < 0) {
+        result.status = get_status();
+        return true;
+      }
+      result.written += ret;
+      return result.written == size;
+    });
+    if (active.empty()) {
+      break;
+    }
+
+    auto remaining = 0L;
+    if (timeout_ms > 0) {
+      remaining = static_cast<long>(
+          std::chrono::ceil<std::chrono::milliseconds>(deadline
+                                                       - steady_clock::now())
+              .count());
+      if (remaining <= 0L) {
+        break;
+      }
+    }
+
+    sp_event_set *events_raw_ptr = nullptr;
+    if (sp_new_event_set(&events_raw_ptr) != SP_OK) {
+      for (const auto i : active) {
+        results[i].status = status_t::SystemError;
+      }
+      break;
+    }
+    const auto events = std::unique_ptr<sp_event_set, void (*)(sp_event_set *)>{
+        events_raw_ptr, sp_free_event_set};
+    for (const auto i : active) {
+      sp_add_port_events(events.get(), conns[i]->get_port().get(),
+                         SP_EVENT_TX_READY);
+    }
+    if (sp_wait(events.get(), static_cast<unsigned>(remaining)) != SP_OK) {
+      for (const auto i : active) {
+        results[i].status = status_t::SystemError;
+      }
+      break;
+    }
+  }
+  return results;
+}
@@ -0,0 +1,51 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Runs a function for many indices on a pool of worker threads.
+
+#ifndef SPP_FOR_EACH_PARALLEL_HPP_INCLUDED
+#define SPP_FOR_EACH_PARALLEL_HPP_INCLUDED
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace sp::detail {
+
+  // calls `fn` with every index below `count`, on up to `max_workers` threads,
+  // one of which is the calling thread, and returns once all calls have
+  // returned
+  // if not all threads can be started, the others carry on without them
+  // `fn` must not throw
+  template <typename Fn>
+  void for_each_parallel(const std::size_t count, const unsigned max_workers,
+                         Fn fn) {
+    if (count == 0U) {
+      return;
+    }
+    auto next = std::atomic<std::size_t>{0U};
+    const auto work = [&] {
+      for (auto i = next++; i < count; i = next++) {
+        fn(i);
+      }
+    };
+
+    const auto helpers =
+        std::min<std::size_t>(std::max(max_workers, 1U), count) - 1U;
+    auto threads = std::vector<std::jthread>{};
+    try {
+      threads.reserve(helpers);
+      for (auto i = std::size_t{0}; i < helpers; ++i) {
+        threads.emplace_back(work);
+      }
+    } catch (const std::exception &) {
+      // the workers that have been started carry on without the others
+    }
+    work();
+  } // the other workers are joined as `threads` goes out of scope
+
+} // namespace sp::detail
+
+#endif // SPP_FOR_EACH_PARALLEL_HPP_INCLUDED
@@ -2,14 +2,29 @@
 
 #include <libserialport.hpp>
 
+#include "status.hpp"
+
 #include <libserialport.h>
 
+#ifndef _WIN32
+#include <sys/uio.h>
+
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <memory>
+#include <thread>
 #include <utility>
 #include <vector>
 
 namespace {
-  sp::status_t status_;
+  thread_local sp::status_t status_;
 
   std::shared_ptr<sp_port> manage(sp_port *const raw_ptr) {
     return {raw_ptr, [](sp_port *const p) { sp_free_port(p); }};
@@ -27,6 +42,52 @@ namespace {
     return {raw_ptr, []([[maybe_unused]] const char *const p) {}};
   }
 
+  // at most this many buffers are filled by a single system call
+  constexpr auto max_scatter_buffers = 64U;
+
+  // an adaptive read ends once the line has been quiet for this many
+  // characters, like a Modbus RTU frame does after 3.5
+  constexpr auto idle_gap_characters = 4L;
+
+  // returns the position `offset` bytes into the buffers, as the index of
+  // the buffer and the offset within it
+  std::pair<std::size_t, std::size_t>
+  locate(const std::span<const std::span<std::byte>> bufs, std::size_t offset) {
+    auto i = std::size_t{0};
+    while (i < bufs.size() && offset >= bufs[i].size()) {
+      offset -= bufs[i].size();
+      ++i;
+    }
+    return {i, offset};
+  }
+
+#ifndef _WIN32
+  // reads into the buffers from `offset` bytes on with a single `readv`
+  // returns the number of bytes read, or -1 on error or at the end of the
+  // file, i.e. once the other end has hung up
+  long scatter_read(const int fd,
+                    const std::span<const std::span<std::byte>> bufs,
+                    const std::size_t offset) {
+    auto iov = std::array<iovec, max_scatter_buffers>{};
+    auto [i, within] = locate(bufs, offset);
+    auto count = 0;
+    for (; i < bufs.size() && count < static_cast<int>(iov.size()); ++i) {
+      if (bufs[i].size() > within) {
+        iov[static_cast<std::size_t>(count++)] = {bufs[i].data() + within,
+                                                  bufs[i].size() - within};
+      }
+      within = 0U;
+    }
+    const auto ret = readv(fd, iov.data(), count);
+    if (ret < 0) {
+      return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ? 0L
+                                                                       : -1L;
+    }
+    // the descriptor is nonblocking, so nothing read means no more to come
+    return ret > 0 ? static_cast<long>(ret) : -1L;
+  }
+#endif
+
   const char *empty_if_null(const char *const str) {
     if (str != nullptr) {
       return str;
@@ -37,6 +98,10 @@ namespace {
 
 sp::status_t sp::get_status() noexcept { return status_; }
 
+sp::status_t sp::detail::set_status(const status_t status) noexcept {
+  return status_ = status;
+}
+
 std::shared_ptr<const char> sp::last_error_message() {
   switch (status_) {
   case status_t::OK:
@@ -78,11 +143,35 @@ std::vector<sp::port_t> sp::list_ports() {
   return result;
 }
 
+std::pmr::vector<sp::port_t>
+sp::list_ports(std::pmr::memory_resource *const resource) {
+  auto result = std::pmr::vector<port_t>{resource};
+  sp_port **ports = nullptr;
+
+  if (status_ = status_t{sp_list_ports(&ports)}; status_ == status_t::OK) {
+    auto count = std::size_t{0};
+    while (ports[count] != nullptr) {
+      ++count;
+    }
+    result.reserve(count);
+    for (auto i = 0; ports[i] != nullptr; ++i) {
+      result.emplace_back(ports[i],
+                          [](sp_port *const p) { sp_free_port(p); },
+                          std::pmr::polymorphic_allocator<>{resource});
+    }
+    ports[0] = nullptr;
+    sp_free_port_list(ports);
+  }
+
+  return result;
+}
+
 const char *sp::get_name(const port_t &p) noexcept {
   return empty_if_null(sp_get_port_name(p.get()));
 }
 
 const char *sp::get_description(const port_t &p) noexcept {
+  fetch_metadata(p);
   return empty_if_null(sp_get_port_description(p.get()));
 }
 
@@ -91,6 +180,7 @@ sp::transport_t sp::get_transport(const port_t &p) noexcept {
 }
 
 sp::usb_bus_address_t sp::get_usb_bus_address(const port_t &p) noexcept {
+  fetch_metadata(p);
   auto result = usb_bus_address_t{-1, -1};
   status_ = status_t{
       sp_get_port_usb_bus_address(p.get(), &result.bus, &result.address)};
@@ -98,6 +188,7 @@ sp::usb_bus_address_t sp::get_usb_bus_address(const port_t &p) noexcept {
 }
 
 sp::usb_vid_pid_t sp::get_usb_vid_pid(const port_t &p) noexcept {
+  fetch_metadata(p);
   auto result = usb_vid_pid_t{-1, -1};
   status_ = status_t{
       sp_get_port_usb_vid_pid(p.get(), &result.vid, &result.pid)};
@@ -105,18 +196,22 @@ sp::usb_vid_pid_t sp::get_usb_vid_pid(const port_t &p) noexcept {
 }
 
 const char *sp::get_usb_manufacturer(const port_t &p) noexcept {
+  fetch_metadata(p);
   return empty_if_null(sp_get_port_usb_manufacturer(p.get()));
 }
 
 const char *sp::get_usb_product(const port_t &p) noexcept {
+  fetch_metadata(p);
   return empty_if_null(sp_get_port_usb_product(p.get()));
 }
 
 const char *sp::get_usb_serial_no(const port_t &p) noexcept {
+  fetch_metadata(p);
   return empty_if_null(sp_get_port_usb_serial(p.get()));
 }
 
 const char *sp::get_bluetooth_address(const port_t &p) noexcept {
+  fetch_metadata(p);
   return empty_if_null(sp_get_port_bluetooth_address(p.get()));
 }
 
@@ -135,6 +230,8 @@ sp::connection::connection(port_t p, const mode_t m, const port_config_t &cfg) {
 
 sp::connection::~connection() { sp_close(p_.get()); }
 
+const sp::port_t &sp::connection::get_port() const noexcept { return p_; }
+
 sp::port_config_t sp::connection::get_config() const {
   auto *cfg_raw_ptr = static_cast<sp_port_config *>(nullptr);
   sp_new_config(&cfg_raw_ptr);
@@ -153,18 +250,86 @@ sp::port_config_t sp::connection::get_config() const {
 }
 
 sp::status_t sp::connection::set_config(const port_config_t &cfg) {
-  auto *cfg_raw_ptr = static_cast<sp_port_config *>(nullptr);
-  sp_new_config(&cfg_raw_ptr);
-  auto port_cfg = manage(cfg_raw_ptr);
+  // dispatches to the specialisation for the settings that are not left alone
+  static constexpr auto apply =
+      []<std::size_t... Fields>(std::index_sequence<Fields...>) {
+        return std::array{
+            &connection::apply_config<static_cast<config_field_t>(Fields)>...};
+      }(std::make_index_sequence<static_cast<std::size_t>(config_field_t::All)
+                                 + 1U>{});
+  return (this->*apply[static_cast<std::size_t>(fields_of(cfg))])(cfg);
+}
 
-  status_ = status_t{sp_set_config_baudrate(cfg_raw_ptr, cfg.baud_rate)};
-  status_ = status_t{sp_set_config_bits(cfg_raw_ptr, cfg.bits)};
-  status_ = status_t{
-      sp_set_config_parity(cfg_raw_ptr, static_cast<sp_parity>(cfg.parity))};
-  status_ = status_t{sp_set_config_stopbits(cfg_raw_ptr, cfg.stop_bits)};
-  return status_t{sp_set_config(p_.get(), cfg_raw_ptr)};
+template <sp::config_field_t Fields>
+sp::status_t sp::connection::apply_config(const port_config_t &cfg) {
+  // whichever overload of `set_config` is used, the baud rate may change
+  character_time_us_ = 0;
+  constexpr auto has = [](const config_field_t field) {
+    return (static_cast<std::uint8_t>(Fields) & static_cast<std::uint8_t>(field))
+           != 0U;
+  };
+
+  if constexpr (Fields == config_field_t::None) {
+    status_ = status_t::OK;
+    return status_t::OK;
+  } else {
+    auto *cfg_raw_ptr = static_cast<sp_port_config *>(nullptr);
+    sp_new_config(&cfg_raw_ptr);
+    auto port_cfg = manage(cfg_raw_ptr);
+
+    if constexpr (has(config_field_t::BaudRate)) {
+      status_ = status_t{sp_set_config_baudrate(cfg_raw_ptr, cfg.baud_rate)};
+    }
+    if constexpr (has(config_field_t::Bits)) {
+      status_ = status_t{sp_set_config_bits(cfg_raw_ptr, cfg.bits)};
+    }
+    if constexpr (has(config_field_t::Parity)) {
+      status_ = status_t{sp_set_config_parity(
+          cfg_raw_ptr, static_cast<sp_parity>(cfg.parity))};
+    }
+    if constexpr (has(config_field_t::StopBits)) {
+      status_ = status_t{sp_set_config_stopbits(cfg_raw_ptr, cfg.stop_bits)};
+    }
+    const auto status = status_t{sp_set_config(p_.get(), cfg_raw_ptr)};
+    if (status != status_t::OK || !error_marking_) {
+      return status;
+    }
+    // libserialport ignores parity errors again, e.g. without a parity
+    return apply_error_marking(
+        true, has(config_field_t::Parity) && cfg.parity != parity_t::Invalid);
+  }
 }
 
+// the `static_config` overloads in the header rely on these
+// explicit instantiations cannot be expanded from a parameter pack, so they
+// are doubled up by the preprocessor, for every combination of fields
+#define SPP_INSTANTIATE_APPLY_CONFIG_1(fields)                                \
+  template sp::status_t                                                       \
+      sp::connection::apply_config<sp::config_field_t{fields}>(                \
+          const port_config_t &);
+#define SPP_INSTANTIATE_APPLY_CONFIG_2(fields)                                \
+  SPP_INSTANTIATE_APPLY_CONFIG_1(fields)                                      \
+  SPP_INSTANTIATE_APPLY_CONFIG_1((fields) + 1U)
+#define SPP_INSTANTIATE_APPLY_CONFIG_4(fields)                                \
+  SPP_INSTANTIATE_APPLY_CONFIG_2(fields)                                      \
+  SPP_INSTANTIATE_APPLY_CONFIG_2((fields) + 2U)
+#define SPP_INSTANTIATE_APPLY_CONFIG_8(fields)                                \
+  SPP_INSTANTIATE_APPLY_CONFIG_4(fields)                                      \
+  SPP_INSTANTIATE_APPLY_CONFIG_4((fields) + 4U)
+#define SPP_INSTANTIATE_APPLY_CONFIG_16(fields)                               \
+  SPP_INSTANTIATE_APPLY_CONFIG_8(fields)                                      \
+  SPP_INSTANTIATE_APPLY_CONFIG_8((fields) + 8U)
+
+static_assert(static_cast<std::size_t>(sp::config_field_t::All) + 1U == 16U,
+              "instantiate apply_config for the new combinations of fields");
+SPP_INSTANTIATE_APPLY_CONFIG_16(0U)
+
+#undef SPP_INSTANTIATE_APPLY_CONFIG_16
+#undef SPP_INSTANTIATE_APPLY_CONFIG_8
+#undef SPP_INSTANTIATE_APPLY_CONFIG_4
+#undef SPP_INSTANTIATE_APPLY_CONFIG_2
+#undef SPP_INSTANTIATE_APPLY_CONFIG_1
+
 int sp::connection::read_blocking(void *const buf, const int count,
                                   const long timeout_ms) {
   if (count <= 0 || timeout_ms < 0) {
@@ -211,6 +376,236 @@ int sp::connection::read_nonblocking(void *const buf, const int count) {
   return ret;
 }
 
+int sp::connection::read_adaptive(void *const buf, const int count,
+                                  const long timeout_ms,
+                                  const long latency_budget_ms) {
+  if (count <= 0 || timeout_ms < 0 || latency_budget_ms < 0) {
+    status_ = status_t::InvalidArgument;
+    return -1;
+  }
+  auto *const bytes = static_cast<char *>(buf);
+
+  const auto waiting = input_waiting();
+  if (waiting < 0) {
+    return -1;
+  }
+  const auto ret = waiting > 0
+                       ? read_nonblocking(bytes, std::min(waiting, count))
+                       : read_next_blocking(bytes, count, timeout_ms);
+  if (ret <= 0 || ret == count || latency_budget_ms == 0) {
+    return ret;
+  }
+
+  if (character_time_us_ == 0) {
+    character_time_us_ = character_time_us(get_config());
+  }
+  if (character_time_us_ < 0) {
+    return ret;
+  }
+  const auto expected = static_cast<int>(std::min<long>(
+      count - ret, latency_budget_ms * 1'000L / character_time_us_));
+  if (expected <= 0) {
+    return ret;
+  }
+
+  using std::chrono::steady_clock;
+  const auto deadline =
+      steady_clock::now() + std::chrono::milliseconds{latency_budget_ms};
+  const auto gap_ms =
+      std::max(1L, (idle_gap_characters * character_time_us_ + 999L) / 1'000L);
+  const auto limit = ret + expected;
+  auto total = ret;
+  while (total < limit) {
+    const auto remaining = static_cast<long>(
+        std::chrono::ceil<std::chrono::milliseconds>(deadline
+                                                     - steady_clock::now())
+            .count());
+    if (remaining <= 0) {
+      break;
+    }
+    // any error is left in the status, but must not discard what has been read
+    const auto more = read_next_blocking(bytes + total, limit - total,
+                                         std::min(gap_ms, remaining));
+    if (more <= 0) {
+      break;
+    }
+    total += more;
+  }
+  return total;
+}
+
+int sp::connection::read_timestamped(void *const buf, const int count,
+                                     const long timeout_ms,
+                                     std::vector<rx_chunk_t> &chunks) {
+  using std::chrono::steady_clock;
+
+  if (count <= 0 || timeout_ms < 0) {
+    status_ = status_t::InvalidArgument;
+    return -1;
+  }
+  auto *const bytes = static_cast<char *>(buf);
+  const auto deadline =
+      steady_clock::now() + std::chrono::milliseconds{timeout_ms};
+
+  sp_event_set *events_raw_ptr = nullptr;
+  if (const auto ret = sp_new_event_set(&events_raw_ptr); ret != SP_OK) {
+    status_ = status_t{ret};
+    return -1;
+  }
+  const auto events = std::unique_ptr<sp_event_set, void (*)(sp_event_set *)>{
+      events_raw_ptr, sp_free_event_set};
+  if (const auto ret =
+          sp_add_port_events(events.get(), p_.get(), SP_EVENT_RX_READY);
+      ret != SP_OK) {
+    status_ = status_t{ret};
+    return -1;
+  }
+
+  auto done = 0;
+  auto ready_at = steady_clock::now();
+  auto backlogged = true;
+  while (true) {
+    const auto ret = read_nonblocking(bytes + done, count - done);
+    if (ret < 0) {
+      // any error is left in the status, but must not discard what has been
+      // read
+      return done > 0 ? done : -1;
+    }
+    if (ret > 0) {
+      chunks.push_back({done, ret, ready_at, backlogged});
+      done += ret;
+    }
+    if (done == count) {
+      break;
+    }
+    backlogged = false;
+
+    auto remaining = 0L;
+    if (timeout_ms > 0) {
+      remaining = static_cast<long>(
+          std::chrono::ceil<std::chrono::milliseconds>(deadline
+                                                       - steady_clock::now())
+              .count());
+      if (remaining <= 0) {
+        break;
+      }
+    }
+    if (const auto wait_ret =
+            sp_wait(events.get(), static_cast<unsigned>(remaining));
+        wait_ret != SP_OK) {
+      status_ = status_t{wait_ret};
+      return done > 0 ? done : -1;
+    }
+    // taken before reading, so that it does not include the time to copy
+    ready_at = steady_clock::now();
+  }
+  return done;
+}
+
+int sp::connection::read_blocking(
+    const std::span<const std::span<std::byte>> bufs, const long timeout_ms) {
+  return read_scatter(bufs, timeout_ms, true, true);
+}
+
+int sp::connection::read_next_blocking(
+    const std::span<const std::span<std::byte>> bufs, const long timeout_ms) {
+  return read_scatter(bufs, timeout_ms, true, false);
+}
+
+int sp::connection::read_nonblocking(
+    const std::span<const std::span<std::byte>> bufs) {
+  return read_scatter(bufs, 0, false, false);
+}
+
+int sp::connection::read_scatter(
+    const std::span<const std::span<std::byte>> bufs, const long timeout_ms,
+    const bool blocking, const bool until_full) {
+  using std::chrono::steady_clock;
+
+  auto total = std::size_t{0};
+  for (const auto &buf : bufs) {
+    total += buf.size();
+  }
+  if (total == 0U
+      || total > static_cast<std::size_t>(std::numeric_limits<int>::max())
+      || timeout_ms < 0) {
+    status_ = status_t::InvalidArgument;
+    return -1;
+  }
+  const auto deadline =
+      steady_clock::now() + std::chrono::milliseconds{timeout_ms};
+
+  auto fd = -1;
+#ifndef _WIN32
+  if (sp_get_port_handle(p_.get(), &fd) != SP_OK) {
+    fd = -1;
+  }
+#endif
+
+  // only set up once there is a need to wait
+  auto events = std::unique_ptr<sp_event_set, void (*)(sp_event_set *)>{
+      nullptr, sp_free_event_set};
+
+  auto done = std::size_t{0};
+  while (true) {
+    auto ret = 0L;
+#ifndef _WIN32
+    if (fd >= 0) {
+      ret = scatter_read(fd, bufs, done);
+      if (ret < 0) {
+        status_ = status_t::SystemError;
+        return -1;
+      }
+    } else
+#endif
+    {
+      // without a descriptor to `readv` from, the buffers are read one by one
+      const auto [i, within] = locate(bufs, done);
+      const auto n =
+          read_nonblocking(bufs[i].data() + within,
+                           static_cast<int>(bufs[i].size() - within));
+      if (n < 0) {
+        return -1;
+      }
+      ret = n;
+    }
+    done += static_cast<std::size_t>(ret);
+
+    if (done == total || !blocking || (!until_full && done > 0U)) {
+      break;
+    }
+    if (ret > 0) {
+      continue; // more may be waiting
+    }
+
+    auto remaining = 0L;
+    if (timeout_ms > 0) {
+      remaining = static_cast<long>(
+          std::chrono::ceil<std::chrono::milliseconds>(deadline
+                                                       - steady_clock::now())
+              .count());
+      if (remaining <= 0) {
+        break;
+      }
+    }
+    if (!events) {
+      sp_event_set *events_raw_ptr = nullptr;
+      if (const auto r = sp_new_event_set(&events_raw_ptr); r != SP_OK) {
+        status_ = status_t{r};
+        return -1;
+      }
+      events.reset(events_raw_ptr);
+      sp_add_port_events(events.get(), p_.get(), SP_EVENT_RX_READY);
+    }
+    if (const auto r = sp_wait(events.get(), static_cast<unsigned>(remaining));
+        r != SP_OK) {
+      status_ = status_t{r};
+      return -1;
+    }
+  }
+  return static_cast<int>(done);
+}
+
 int sp::connection::input_waiting() {
   const auto ret = sp_input_waiting(p_.get());
   if (ret < 0) {
@@ -259,6 +654,82 @@ int sp::connection::output_waiting() {
   return ret;
 }
 
+int sp::connection::read_marked(void *const buf, const int count,
+                                const long timeout_ms,
+                                std::vector<line_event_t> &events) {
+  using std::chrono::steady_clock;
+
+  if (count <= 0 || timeout_ms < 0) {
+    status_ = status_t::InvalidArgument;
+    return -1;
+  }
+  auto *const bytes = static_cast<char *>(buf);
+  const auto deadline =
+      steady_clock::now() + std::chrono::milliseconds{timeout_ms};
+  const auto first_event = events.size();
+
+  auto decoded = 0;
+  while (true) {
+    auto remaining = 0L;
+    if (timeout_ms > 0) {
+      remaining = static_cast<long>(
+          std::chrono::ceil<std::chrono::milliseconds>(deadline
+                                                       - steady_clock::now())
+              .count());
+      if (remaining <= 0) {
+        break;
+      }
+    }
+    const auto ret = read_next_blocking(bytes, count, remaining);
+    if (ret <= 0) {
+      if (ret < 0) {
+        return -1;
+      }
+      break;
+    }
+    // a read may have ended within a mark, leaving nothing to report yet
+    decoded = parmrk_.decode(bytes, ret, events);
+    if (decoded > 0 || events.size() != first_event) {
+      break;
+    }
+  }
+
+  const auto counts = get_error_counts();
+  const auto delta = [](const long now, const long before) {
+    return now >= 0 && before >= 0 ? now - before : -1L;
+  };
+  const auto parity = delta(counts.parity, error_counts_.parity);
+  const auto framing = delta(counts.framing, error_counts_.framing);
+  if (parity >= 0 && framing >= 0 && (parity == 0) != (framing == 0)) {
+    for (auto i = first_event; i < events.size(); ++i) {
+      if (events[i].error == line_error_t::ParityOrFraming) {
+        events[i].error =
+            parity > 0 ? line_error_t::Parity : line_error_t::Framing;
+      }
+    }
+  }
+  if (delta(counts.overrun, error_counts_.overrun) > 0
+      || delta(counts.buffer_overrun, error_counts_.buffer_overrun) > 0) {
+    events.push_back({decoded, line_error_t::Overrun});
+  }
+  error_counts_ = counts;
+  return decoded;
+}
+
+sp::status_t sp::connection::send_break(const int duration_ms) {
+  if (duration_ms <= 0) {
+    status_ = status_t::InvalidArgument;
+    return status_;
+  }
+  status_ = status_t{sp_start_break(p_.get())};
+  if (status_ != status_t::OK) {
+    return status_;
+  }
+  std::this_thread::sleep_for(std::chrono::milliseconds{duration_ms});
+  status_ = status_t{sp_end_break(p_.get())};
+  return status_;
+}
+
 sp::status_t sp::connection::flush(buffer_t buffers_to_flush) {
   status_ = status_t{
       sp_flush(p_.get(), static_cast<sp_buffer>(buffers_to_flush))};
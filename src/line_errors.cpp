@@ -0,0 +1,130 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Reports line errors, such as breaks and parity errors.
+
+#include <libserialport.hpp>
+
+#include "status.hpp"
+
+#include <config.h>
+
+#ifndef _WIN32
+#include <termios.h>
+#endif
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#ifdef HAVE_STRUCT_SERIAL_STRUCT
+#include <linux/serial.h>
+#endif
+#endif
+
+int sp::parmrk_decoder::decode(char *const buf, const int count,
+                               std::vector<line_event_t> &events) {
+  auto out = 0;
+  for (auto i = 0; i < count; ++i) {
+    const auto c = static_cast<unsigned char>(buf[i]);
+    switch (state_) {
+    case 0U:
+      if (c == 0377U) {
+        state_ = 1U;
+      } else {
+        buf[out++] = buf[i];
+      }
+      break;
+    case 1U:
+      if (c == 0U) {
+        state_ = 2U;
+      } else {
+        // `\377 \377`, or else not a mark, in which case it is passed on
+        buf[out++] = buf[i];
+        state_ = 0U;
+      }
+      break;
+    default:
+      if (c == 0U) {
+        events.push_back({out, line_error_t::Break});
+      } else {
+        events.push_back({out, line_error_t::ParityOrFraming});
+        buf[out++] = buf[i];
+      }
+      state_ = 0U;
+      break;
+    }
+  }
+  return out;
+}
+
+void sp::parmrk_decoder::reset() noexcept { state_ = 0U; }
+
+#ifndef _WIN32
+namespace {
+  // the input flags that error marking changes
+  constexpr auto marking_iflags = static_cast<tcflag_t>(
+      PARMRK | INPCK | IGNPAR | IGNBRK | BRKINT | ISTRIP);
+} // namespace
+#endif
+
+sp::status_t sp::connection::set_error_marking(const bool enable) {
+  if (!enable && !error_marking_) {
+    // nothing has been changed that could be restored
+    return detail::set_status(status_t::OK);
+  }
+  if (apply_error_marking(enable) != status_t::OK) {
+    return get_status();
+  }
+  error_marking_ = enable;
+  parmrk_.reset();
+  error_counts_ = get_error_counts();
+  return status_t::OK;
+}
+
+sp::status_t sp::connection::apply_error_marking(const bool enable,
+                                                 const bool adopt_parity) {
+  using detail::set_status;
+#ifndef _WIN32
+  auto fd = -1;
+  if (get_native_handle(p_, &fd) != status_t::OK || fd < 0) {
+    return set_status(status_t::SystemError);
+  }
+  auto tio = termios{};
+  if (tcgetattr(fd, &tio) < 0) {
+    return set_status(status_t::SystemError);
+  }
+  if (enable) {
+    // what `set_config` has just set about parity is restored later on
+    const auto adopted = !error_marking_ ? marking_iflags
+                         : adopt_parity  ? static_cast<tcflag_t>(IGNPAR)
+                                         : tcflag_t{0};
+    saved_iflag_ = (saved_iflag_ & ~adopted) | (tio.c_iflag & adopted);
+    tio.c_iflag |= PARMRK | INPCK;
+    tio.c_iflag &= ~static_cast<tcflag_t>(IGNPAR | IGNBRK | BRKINT | ISTRIP);
+  } else {
+    tio.c_iflag = (tio.c_iflag & ~marking_iflags)
+                  | (static_cast<tcflag_t>(saved_iflag_) & marking_iflags);
+  }
+  return set_status(tcsetattr(fd, TCSANOW, &tio) < 0 ? status_t::SystemError
+                                                      : status_t::OK);
+#else
+  (void)enable;
+  (void)adopt_parity;
+  return set_status(status_t::NotSupported);
+#endif
+}
+
+sp::line_error_counts_t sp::connection::get_error_counts() {
+  auto result = line_error_counts_t{};
+#if defined(__linux__) && defined(HAVE_STRUCT_SERIAL_STRUCT)
+  auto fd = -1;
+  auto counters = serial_icounter_struct{};
+  if (get_native_handle(p_, &fd) == status_t::OK && fd >= 0
+      && ioctl(fd, TIOCGICOUNT, &counters) == 0) {
+    result.breaks = counters.brk;
+    result.framing = counters.frame;
+    result.parity = counters.parity;
+    result.overrun = counters.overrun;
+    result.buffer_overrun = counters.buf_overrun;
+  }
+#endif
+  return result;
+}
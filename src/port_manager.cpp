@@ -0,0 +1,283 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Keeps connections to a set of ports alive across disconnects.
+
+#include <spp/port_manager.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <filesystem>
+#include <optional>
+#include <random>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+namespace {
+  constexpr auto contended_retry = std::chrono::milliseconds{1};
+} // namespace
+
+struct sp::port_manager::entry {
+  port_identity_t id;
+  mode_t mode;
+  port_config_t cfg;
+
+  // guards everything below, held while the connection is in use
+  std::mutex mutex;
+  std::optional<connection> conn;
+  int failed_attempts{0};
+  std::chrono::steady_clock::time_point next_attempt;
+  // set once the entry is no longer managed, as the supervisor may still
+  // hold on to it
+  bool removed{false};
+  // mirrors `conn.has_value()` for the supervisor, which does not wait for
+  // entries that are in use
+  std::atomic<bool> connected{false};
+
+  bool try_connect(const port_t &p) {
+    if (!p) {
+      return false;
+    }
+    try {
+      conn.emplace(p, mode, cfg);
+    } catch (const connection_exc &) {
+      return false;
+    }
+    connected = true;
+    return true;
+  }
+
+  void disconnect() {
+    conn.reset();
+    connected = false;
+  }
+};
+
+bool sp::operator==(const port_identity_t &lhs, const port_identity_t &rhs) {
+  return lhs.usb_vid_pid == rhs.usb_vid_pid
+         && lhs.usb_serial_no == rhs.usb_serial_no && lhs.path == rhs.path;
+}
+
+bool sp::is_empty(const port_identity_t &id) noexcept {
+  return id.usb_vid_pid.vid < 0 && id.usb_vid_pid.pid < 0
+         && id.usb_serial_no.empty() && id.path.empty();
+}
+
+bool sp::matches(const port_identity_t &id, const port_t &p) {
+  if (!p) {
+    return false;
+  }
+  if (id.usb_vid_pid.vid >= 0 || id.usb_vid_pid.pid >= 0) {
+    const auto vid_pid = get_usb_vid_pid(p);
+    if ((id.usb_vid_pid.vid >= 0 && id.usb_vid_pid.vid != vid_pid.vid)
+        || (id.usb_vid_pid.pid >= 0 && id.usb_vid_pid.pid != vid_pid.pid)) {
+      return false;
+    }
+  }
+  return id.usb_serial_no.empty()
+         || id.usb_serial_no == std::string_view{get_usb_serial_no(p)};
+}
+
+sp::port_t sp::find_port(const port_identity_t &id,
+                         const std::vector<port_t> &candidates) {
+  if (!id.path.empty()) {
+    // libserialport identifies ports by their device node, not by symlinks
+    auto ec = std::error_code{};
+    const auto node = std::filesystem::canonical(id.path, ec);
+    if (ec) {
+      return {};
+    }
+    auto p = get_port_by_name(node.c_str());
+    return matches(id, p) ? p : port_t{};
+  }
+  const auto it = std::ranges::find_if(
+      candidates, [&id](const port_t &p) { return matches(id, p); });
+  return it != candidates.end() ? *it : port_t{};
+}
+
+std::chrono::milliseconds sp::backoff_delay(const backoff_t &backoff,
+                                            const int attempt,
+                                            const double random) noexcept {
+  auto delay = backoff.initial;
+  for (auto i = 0; i < attempt && delay < backoff.max; ++i) {
+    delay *= 2;
+  }
+  delay = std::min(delay, backoff.max);
+  const auto jitter = std::clamp(backoff.jitter, 0.0, 1.0);
+  const auto scale = 1.0 - jitter + jitter * random;
+  return std::chrono::milliseconds{static_cast<std::chrono::milliseconds::rep>(
+      static_cast<double>(delay.count()) * scale)};
+}
+
+sp::port_manager::port_manager(const backoff_t backoff)
+    : backoff_{backoff},
+      supervisor_{[this](const std::stop_token &stop) { supervise(stop); }} {}
+
+sp::port_manager::~port_manager() = default;
+
+sp::status_t sp::port_manager::add(const port_identity_t &id, const mode_t m,
+                                   const port_config_t &cfg) {
+  if (is_empty(id)) {
+    return status_t::InvalidArgument;
+  }
+  auto e = std::make_shared<entry>();
+  e->id = id;
+  e->mode = m;
+  e->cfg = cfg;
+  {
+    const auto lock = std::scoped_lock{mutex_};
+    if (std::ranges::any_of(entries_, [&id](const auto &candidate) {
+          return candidate->id == id;
+        })) {
+      return status_t::InvalidArgument;
+    }
+    entries_.push_back(std::move(e));
+  }
+  schedule_reconnect();
+  return status_t::OK;
+}
+
+sp::status_t sp::port_manager::remove(const port_identity_t &id) {
+  auto e = std::shared_ptr<entry>{};
+  {
+    const auto lock = std::scoped_lock{mutex_};
+    const auto it = std::ranges::find_if(
+        entries_, [&id](const auto &candidate) { return candidate->id == id; });
+    if (it == entries_.end()) {
+      return status_t::InvalidArgument;
+    }
+    e = std::move(*it);
+    entries_.erase(it);
+  }
+  const auto lock = std::scoped_lock{e->mutex};
+  e->removed = true;
+  e->disconnect();
+  return status_t::OK;
+}
+
+bool sp::port_manager::is_connected(const port_identity_t &id) const {
+  const auto e = find(id);
+  if (!e) {
+    return false;
+  }
+  const auto lock = std::scoped_lock{e->mutex};
+  return e->conn.has_value();
+}
+
+sp::status_t sp::port_manager::set_config(const port_identity_t &id,
+                                          const port_config_t &cfg) {
+  const auto e = find(id);
+  if (!e) {
+    return status_t::InvalidArgument;
+  }
+  const auto lock = std::scoped_lock{e->mutex};
+  if (e->removed) {
+    return status_t::InvalidArgument;
+  }
+  e->cfg = cfg;
+  if (!e->conn) {
+    return status_t::OK;
+  }
+  return e->conn->set_config(cfg);
+}
+
+sp::status_t sp::port_manager::with_connection(
+    const port_identity_t &id, const std::function<void(connection &)> &fn) {
+  const auto e = find(id);
+  if (!e) {
+    return status_t::InvalidArgument;
+  }
+  auto lock = std::unique_lock{e->mutex};
+  if (e->removed) {
+    return status_t::InvalidArgument;
+  }
+  if (!e->conn) {
+    return status_t::SystemError;
+  }
+  fn(*e->conn);
+  const auto status = get_status();
+  // the status may stem from an earlier call, so check whether port is alive
+  if (status == status_t::SystemError && e->conn->input_waiting() < 0) {
+    e->disconnect();
+    e->failed_attempts = 0;
+    e->next_attempt = std::chrono::steady_clock::now();
+    lock.unlock();
+    schedule_reconnect();
+  }
+  return status;
+}
+
+std::shared_ptr<sp::port_manager::entry>
+sp::port_manager::find(const port_identity_t &id) const {
+  const auto lock = std::scoped_lock{mutex_};
+  const auto it = std::ranges::find_if(
+      entries_, [&id](const auto &candidate) { return candidate->id == id; });
+  return it != entries_.end() ? *it : nullptr;
+}
+
+void sp::port_manager::schedule_reconnect() {
+  {
+    const auto lock = std::scoped_lock{mutex_};
+    reconnect_pending_ = true;
+  }
+  wakeup_.notify_one();
+}
+
+void sp::port_manager::supervise(const std::stop_token &stop) {
+  auto rng = std::minstd_rand{std::random_device{}()};
+  auto dist = std::uniform_real_distribution<double>{0.0, 1.0};
+
+  while (!stop.stop_requested()) {
+    auto lock = std::unique_lock{mutex_};
+    reconnect_pending_ = false;
+    const auto entries = entries_;
+    lock.unlock();
+
+    // the port list is expensive to get, so only get it once per round
+    auto ports = std::vector<port_t>{};
+    auto next_wakeup = std::optional<std::chrono::steady_clock::time_point>{};
+
+    for (const auto &e : entries) {
+      const auto entry_lock = std::unique_lock{e->mutex, std::try_to_lock};
+      const auto now = std::chrono::steady_clock::now();
+      if (!entry_lock.owns_lock()) {
+        // an entry that is in use is tried again shortly, rather than on the
+        // next unrelated wakeup
+        if (!e->connected) {
+          const auto retry = now + contended_retry;
+          if (!next_wakeup || retry < *next_wakeup) {
+            next_wakeup = retry;
+          }
+        }
+        continue;
+      }
+      // removed while this round was under way
+      if (e->removed || e->conn) {
+        continue;
+      }
+      if (e->next_attempt <= now) {
+        if (e->id.path.empty() && ports.empty()) {
+          ports = list_ports();
+        }
+        if (e->try_connect(find_port(e->id, ports))) {
+          e->failed_attempts = 0;
+          continue;
+        }
+        e->next_attempt =
+            now + backoff_delay(backoff_, e->failed_attempts, dist(rng));
+        ++e->failed_attempts;
+      }
+      if (!next_wakeup || e->next_attempt < *next_wakeup) {
+        next_wakeup = e->next_attempt;
+      }
+    }
+
+    lock.lock();
+    const auto is_woken = [this] { return reconnect_pending_; };
+    if (next_wakeup) {
+      wakeup_.wait_until(lock, stop, *next_wakeup, is_woken);
+    } else {
+      wakeup_.wait(lock, stop, is_woken);
+    }
+  }
+}
@@ -0,0 +1,151 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Lists ports without reading their metadata up front.
+
+// needs to be included as the very first header,
+// because it sets some POSIX macros
+extern "C" {
+#include <libserialport_internal.h>
+}
+
+#include <libserialport.hpp>
+
+#include <config.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <unordered_set>
+
+#ifdef __linux__
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#ifdef HAVE_STRUCT_SERIAL_STRUCT
+#include <linux/serial.h>
+#endif
+#endif
+
+namespace {
+  // ports that have been listed lazily and not been fetched since
+  std::mutex lazy_mutex_;
+  std::unordered_set<const sp_port *> lazy_ports_;
+  // saves taking the lock as long as no ports are listed lazily
+  std::atomic<std::size_t> lazy_count_{0U};
+
+  void forget(const sp_port *const port) {
+    const auto lock = std::scoped_lock{lazy_mutex_};
+    lazy_count_ -= lazy_ports_.erase(port);
+  }
+
+  // the `serial8250` driver registers ports whether there is a UART or not,
+  // so they are probed, as libserialport does
+  [[maybe_unused]] bool is_uart_present(const std::string &name) {
+#if defined(__linux__) && defined(HAVE_STRUCT_SERIAL_STRUCT)
+    const auto fd = open(name.c_str(), O_RDWR | O_NONBLOCK | O_NOCTTY);
+    if (fd < 0) {
+      return false;
+    }
+    auto serial = serial_struct{};
+    const auto present =
+        ioctl(fd, TIOCGSERIAL, &serial) == 0 && serial.type != PORT_UNKNOWN;
+    close(fd);
+    return present;
+#else
+    (void)name;
+    return true;
+#endif
+  }
+
+  // creates a port like `sp_get_port_by_name` does, just without its details
+  [[maybe_unused]] sp::port_t make_lazy_port(const std::string &name,
+                                             const sp_transport transport) {
+    auto *const port = static_cast<sp_port *>(std::calloc(1U, sizeof(sp_port)));
+    if (port == nullptr) {
+      return {};
+    }
+    port->name = strdup(name.c_str());
+    port->transport = transport;
+    port->usb_bus = -1;
+    port->usb_address = -1;
+    port->usb_vid = -1;
+    port->usb_pid = -1;
+    port->fd = -1;
+    {
+      const auto lock = std::scoped_lock{lazy_mutex_};
+      lazy_ports_.insert(port);
+      ++lazy_count_;
+    }
+    return {port, [](sp_port *const p) {
+              forget(p);
+              sp_free_port(p);
+            }};
+  }
+} // namespace
+
+std::vector<sp::port_t>
+sp::list_ports(const metadata_t metadata,
+               [[maybe_unused]] const char *const sysfs_root) {
+#ifdef __linux__
+  if (metadata == metadata_t::Lazy && sysfs_root != nullptr) {
+    namespace fs = std::filesystem;
+    auto ec = std::error_code{};
+    auto entries = fs::directory_iterator{
+        fs::path{sysfs_root} / "class" / "tty", ec};
+    if (!ec) {
+      auto result = std::vector<port_t>{};
+      for (const auto &entry : entries) {
+        // virtual terminals and pseudo terminals are no serial ports
+        const auto target = fs::read_symlink(entry.path(), ec).string();
+        if (ec || target.find("virtual") != std::string::npos) {
+          continue;
+        }
+        const auto driver =
+            fs::read_symlink(entry.path() / "device" / "driver", ec);
+        if (ec) {
+          continue;
+        }
+        const auto name = entry.path().filename().string();
+        if (driver.filename() == "serial8250"
+            && !is_uart_present("/dev/" + name)) {
+          continue;
+        }
+        const auto transport =
+            name.starts_with("rfcomm") ? SP_TRANSPORT_BLUETOOTH
+            : target.find("/usb") != std::string::npos ? SP_TRANSPORT_USB
+                                                       : SP_TRANSPORT_NATIVE;
+        if (auto port = make_lazy_port("/dev/" + name, transport)) {
+          result.push_back(std::move(port));
+        }
+      }
+      return result;
+    }
+  }
+#endif
+  (void)metadata;
+  return list_ports();
+}
+
+sp::status_t sp::fetch_metadata(const port_t &p) noexcept {
+  if (!p || lazy_count_ == 0U) {
+    return status_t::OK;
+  }
+  // the lock is held while fetching, so that a port is fetched once
+  const auto lock = std::scoped_lock{lazy_mutex_};
+  if (!lazy_ports_.contains(p.get())) {
+    return status_t::OK;
+  }
+#ifndef NO_PORT_METADATA
+  const auto status = status_t{get_port_details(p.get())};
+#else
+  const auto status = status_t::OK;
+#endif
+  // only now that the metadata is there may others skip taking the lock
+  lazy_ports_.erase(p.get());
+  --lazy_count_;
+  return status;
+}
@@ -0,0 +1,203 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Tunes drivers beyond the settings that libserialport offers.
+
+#include <libserialport.hpp>
+
+#include "status.hpp"
+
+#include <config.h>
+
+#include <cerrno>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+#ifdef __linux__
+#include <sys/ioctl.h>
+#ifdef HAVE_STRUCT_SERIAL_STRUCT
+#include <linux/serial.h>
+#endif
+#ifdef HAVE_TERMIOS2_SPEED
+#include <asm/termbits.h>
+#endif
+#elif defined(_WIN32)
+#include <windows.h>
+#endif
+
+namespace {
+  std::string latency_timer_path(const std::string_view port_name,
+                                 const std::string_view sysfs_root) {
+    const auto base = port_name.substr(port_name.find_last_of('/') + 1U);
+    auto path = std::string{sysfs_root};
+    path.append("/class/tty/").append(base).append("/device/latency_timer");
+    return path;
+  }
+
+  [[maybe_unused]] sp::status_t status_from_errno() {
+    return errno == ENOTTY || errno == EINVAL ? sp::status_t::NotSupported
+                                              : sp::status_t::SystemError;
+  }
+} // namespace
+
+sp::status_t sp::set_ftdi_latency_timer(const char *const port_name,
+                                        const int latency_timer_ms,
+                                        const char *const sysfs_root) {
+  using detail::set_status;
+  if (port_name == nullptr || *port_name == '\0' || latency_timer_ms < 1
+      || latency_timer_ms > 255) {
+    return set_status(status_t::InvalidArgument);
+  }
+#ifdef __linux__
+  const auto path = latency_timer_path(port_name, sysfs_root);
+  if (auto probe = std::ifstream{path}; !probe) {
+    return set_status(status_t::NotSupported);
+  }
+  auto attribute = std::ofstream{path};
+  attribute << latency_timer_ms;
+  attribute.flush();
+  return set_status(attribute ? status_t::OK : status_t::SystemError);
+#else
+  (void)sysfs_root;
+  return set_status(status_t::NotSupported);
+#endif
+}
+
+int sp::get_ftdi_latency_timer(const char *const port_name,
+                               const char *const sysfs_root) {
+  if (port_name == nullptr || *port_name == '\0') {
+    detail::set_status(status_t::InvalidArgument);
+    return -1;
+  }
+  auto attribute = std::ifstream{latency_timer_path(port_name, sysfs_root)};
+  auto latency_timer_ms = -1;
+  if (!(attribute >> latency_timer_ms)) {
+    detail::set_status(attribute.is_open() ? status_t::SystemError
+                                           : status_t::NotSupported);
+    return -1;
+  }
+  detail::set_status(status_t::OK);
+  return latency_timer_ms;
+}
+
+int sp::connection::get_actual_baud_rate() {
+#if defined(__linux__) && defined(HAVE_TERMIOS2_SPEED)
+  // unlike `get_config`, this reports non-standard rates as they are in effect
+  auto fd = -1;
+  if (get_native_handle(p_, &fd) == status_t::OK && fd >= 0) {
+    auto tio = termios2{};
+    if (ioctl(fd, TCGETS2, &tio) == 0) {
+      detail::set_status(status_t::OK);
+      return static_cast<int>(tio.c_ospeed);
+    }
+  }
+#endif
+  // which leaves the status behind
+  const auto baud_rate = get_config().baud_rate;
+  return get_status() == status_t::OK ? baud_rate : -1;
+}
+
+sp::status_t
+sp::connection::set_buffer_sizes([[maybe_unused]] const buffer_sizes_t &sizes) {
+  using detail::set_status;
+#ifdef _WIN32
+  if (sizes.rx <= 0 || sizes.tx <= 0) {
+    return set_status(status_t::InvalidArgument);
+  }
+  auto handle = HANDLE{};
+  if (get_native_handle(p_, &handle) != status_t::OK) {
+    return set_status(status_t::SystemError);
+  }
+  return set_status(SetupComm(handle, static_cast<DWORD>(sizes.rx),
+                              static_cast<DWORD>(sizes.tx))
+                        ? status_t::OK
+                        : status_t::SystemError);
+#else
+  // the tty layer of Linux sizes its buffers itself
+  return set_status(status_t::NotSupported);
+#endif
+}
+
+sp::buffer_sizes_t sp::connection::get_buffer_sizes() {
+  auto result = buffer_sizes_t{};
+#ifdef _WIN32
+  auto handle = HANDLE{};
+  auto props = COMMPROP{};
+  if (get_native_handle(p_, &handle) != status_t::OK
+      || !GetCommProperties(handle, &props)) {
+    detail::set_status(status_t::SystemError);
+    return result;
+  }
+  result.rx = static_cast<int>(props.dwCurrentRxQueue);
+  result.tx = static_cast<int>(props.dwCurrentTxQueue);
+  detail::set_status(status_t::OK);
+#else
+  // the tty layer of Linux does not tell the sizes of its buffers
+  detail::set_status(status_t::NotSupported);
+#endif
+  return result;
+}
+
+sp::low_latency_t sp::connection::set_low_latency(const bool enable,
+                                                  const int latency_timer_ms) {
+  auto result = low_latency_t{.async_low_latency = status_t::NotSupported,
+                              .latency_timer = status_t::NotSupported,
+                              .latency_timer_ms = -1};
+
+#if defined(__linux__) && defined(HAVE_STRUCT_SERIAL_STRUCT)
+  auto fd = -1;
+  if (get_native_handle(p_, &fd) == status_t::OK && fd >= 0) {
+    auto serial = serial_struct{};
+    if (ioctl(fd, TIOCGSERIAL, &serial) < 0) {
+      result.async_low_latency = status_from_errno();
+    } else if (const auto flags = static_cast<unsigned>(serial.flags);
+               enable == ((flags & ASYNC_LOW_LATENCY) != 0U)
+               || (!enable && !set_async_low_latency_)) {
+      // already as wanted, or else not set by this connection
+      result.async_low_latency = status_t::OK;
+    } else {
+      serial.flags = static_cast<int>(enable ? flags | ASYNC_LOW_LATENCY
+                                             : flags & ~ASYNC_LOW_LATENCY);
+      result.async_low_latency = ioctl(fd, TIOCSSERIAL, &serial) < 0
+                                     ? status_from_errno()
+                                     : status_t::OK;
+      if (result.async_low_latency == status_t::OK) {
+        set_async_low_latency_ = enable;
+      }
+    }
+  }
+#endif
+
+  if (const auto *const name = get_name(p_); *name != '\0') {
+    if (enable) {
+      // only the setting from before the first call is worth restoring
+      if (saved_latency_timer_ms_ < 0) {
+        saved_latency_timer_ms_ = get_ftdi_latency_timer(name);
+      }
+      result.latency_timer = set_ftdi_latency_timer(name, latency_timer_ms);
+    } else if (saved_latency_timer_ms_ > 0) {
+      result.latency_timer =
+          set_ftdi_latency_timer(name, saved_latency_timer_ms_);
+      if (result.latency_timer == status_t::OK) {
+        saved_latency_timer_ms_ = -1;
+      }
+    } else {
+      // nothing has been saved that could be restored, so the timer is left
+      // as it is, and merely looked for
+      saved_latency_timer_ms_ = -1;
+      result.latency_timer = get_ftdi_latency_timer(name) < 0
+                                 ? get_status()
+                                 : status_t::OK;
+    }
+    result.latency_timer_ms = get_ftdi_latency_timer(name);
+  }
+
+  // each setting lowers the latency on its own, so either one will do
+  auto status = result.async_low_latency;
+  if (status != status_t::OK
+      && result.latency_timer != status_t::NotSupported) {
+    status = result.latency_timer;
+  }
+  detail::set_status(status);
+  return result;
+}
@@ -0,0 +1,76 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Sets up connections for deterministic latency.
+
+#include <spp/realtime.hpp>
+
+#include <algorithm>
+#include <array>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+namespace {
+  constexpr auto stack_prefault_size = 64U * 1'024U;
+
+  // touches the stack the I/O path will use, so that it is faulted in now
+  [[gnu::noinline]] void prefault_stack() {
+    auto stack = std::array<unsigned char, stack_prefault_size>{};
+    auto *const page = static_cast<volatile unsigned char *>(stack.data());
+    for (auto i = 0U; i < stack.size(); i += 4'096U) {
+      page[i] = 1U;
+    }
+  }
+} // namespace
+
+sp::realtime::realtime(connection &conn, const realtime_options_t &options)
+    : conn_{&conn}, rx_(std::max(options.rx_buffer_size, std::size_t{1})),
+      tx_(std::max(options.tx_buffer_size, std::size_t{1})) {
+#ifndef _WIN32
+  if (options.lock_memory) {
+    status_.memory_locked = mlockall(MCL_CURRENT | MCL_FUTURE) == 0
+                                ? status_t::OK
+                                : status_t::SystemError;
+  }
+  if (options.priority >= 0) {
+    auto param = sched_param{};
+    param.sched_priority = options.priority;
+    status_.scheduling =
+        pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0
+            ? status_t::OK
+            : status_t::SystemError;
+  }
+#endif
+  if (options.low_latency) {
+    status_.low_latency = conn.set_low_latency(true);
+  }
+  // vectors are zeroed on construction, but written again in case the pages
+  // have been mapped lazily
+  std::ranges::fill(rx_, std::byte{0});
+  std::ranges::fill(tx_, std::byte{0});
+  prefault_stack();
+}
+
+const sp::realtime_status_t &
+sp::realtime::get_realtime_status() const noexcept {
+  return status_;
+}
+
+std::span<const std::byte> sp::realtime::read(const long timeout_ms) noexcept {
+  const auto ret = conn_->read_next_blocking(
+      rx_.data(), static_cast<int>(rx_.size()), timeout_ms);
+  return ret > 0 ? std::span{rx_}.first(static_cast<std::size_t>(ret))
+                 : std::span<const std::byte>{};
+}
+
+std::span<std::byte> sp::realtime::tx_buffer() noexcept { return tx_; }
+
+int sp::realtime::write(const std::size_t count,
+                        const long timeout_ms) noexcept {
+  return conn_->write_blocking(tx_.data(),
+                               static_cast<int>(std::min(count, tx_.size())),
+                               timeout_ms);
+}
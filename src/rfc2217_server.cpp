@@ -0,0 +1,585 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Serves connections to network clients through RFC 2217.
+
+#include <spp/rfc2217_server.hpp>
+
+#include <libserialport.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <span>
+#include <string_view>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  constexpr auto chunk_size = 4'096;
+
+  // telnet commands and options (RFC 854, 856 and 858)
+  namespace telnet {
+    constexpr auto se = std::uint8_t{240};
+    constexpr auto sb = std::uint8_t{250};
+    constexpr auto will = std::uint8_t{251};
+    constexpr auto wont = std::uint8_t{252};
+    constexpr auto do_ = std::uint8_t{253};
+    constexpr auto dont = std::uint8_t{254};
+    constexpr auto iac = std::uint8_t{255};
+
+    constexpr auto binary = std::uint8_t{0};
+    constexpr auto suppress_go_ahead = std::uint8_t{3};
+    constexpr auto com_port = std::uint8_t{44};
+  } // namespace telnet
+
+  // commands of the com port option, which the server answers with the
+  // command plus `server_offset`
+  enum class command_t : std::uint8_t {
+    Signature = 0U,
+    SetBaudRate = 1U,
+    SetDataSize = 2U,
+    SetParity = 3U,
+    SetStopSize = 4U,
+    SetControl = 5U,
+    FlowControlSuspend = 8U,
+    FlowControlResume = 9U,
+    SetLineStateMask = 10U,
+    SetModemStateMask = 11U,
+    PurgeData = 12U
+  };
+
+  constexpr auto server_offset = std::uint8_t{100};
+  constexpr auto signature = std::string_view{"libspp"};
+
+  constexpr bool is_supported(const std::uint8_t option) {
+    return option == telnet::binary || option == telnet::suppress_go_ahead
+           || option == telnet::com_port;
+  }
+
+  // values of `SetControl`
+  namespace control {
+    constexpr auto flow_request = std::uint8_t{0};
+    constexpr auto flow_none = std::uint8_t{1};
+    constexpr auto flow_xon_xoff = std::uint8_t{2};
+    constexpr auto flow_hardware = std::uint8_t{3};
+    constexpr auto break_request = std::uint8_t{4};
+    constexpr auto break_on = std::uint8_t{5};
+    constexpr auto break_off = std::uint8_t{6};
+    constexpr auto dtr_request = std::uint8_t{7};
+    constexpr auto dtr_on = std::uint8_t{8};
+    constexpr auto dtr_off = std::uint8_t{9};
+    constexpr auto rts_request = std::uint8_t{10};
+    constexpr auto rts_on = std::uint8_t{11};
+    constexpr auto rts_off = std::uint8_t{12};
+    constexpr auto inbound_flow_request = std::uint8_t{13};
+    constexpr auto inbound_flow_none = std::uint8_t{14};
+    constexpr auto inbound_flow_last = std::uint8_t{19};
+  } // namespace control
+
+  // subnegotiations are short, anything longer is cut off
+  constexpr auto max_subnegotiation = std::size_t{64};
+} // namespace
+
+struct sp::rfc2217_server::session {
+  enum class state_t : std::uint8_t { Data, Iac, Option, Sub, SubIac };
+
+  session(connection &c, const int listener) : conn{&c}, listen_fd{listener} {
+    get_native_handle(conn->get_port(), &port_fd);
+  }
+
+  ~session() {
+#ifndef _WIN32
+    drop_client();
+    close(listen_fd);
+#endif
+  }
+
+  session(const session &) = delete;
+  session &operator=(const session &) = delete;
+
+  session(session &&) = delete;
+  session &operator=(session &&) = delete;
+
+#ifndef _WIN32
+  void accept_client() {
+    const auto fd = accept4(listen_fd, nullptr, nullptr,
+                            SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      return;
+    }
+    if (client_fd >= 0 || failed) {
+      close(fd); // one client at a time
+      return;
+    }
+    const auto on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    client_fd = fd;
+    state = state_t::Data;
+    local = {};
+    remote = {};
+    // binary transmission keeps telnet from translating line endings
+    negotiate(telnet::will, telnet::binary);
+    negotiate(telnet::do_, telnet::binary);
+    negotiate(telnet::will, telnet::suppress_go_ahead);
+    negotiate(telnet::do_, telnet::suppress_go_ahead);
+    negotiate(telnet::do_, telnet::com_port);
+  }
+
+  void drop_client() {
+    if (client_fd < 0) {
+      return;
+    }
+    close(client_fd);
+    client_fd = -1;
+    to_port.clear();
+    to_client.clear();
+    suspended = false;
+    if (breaking) {
+      sp_end_break(conn->get_port().get());
+      breaking = false;
+    }
+  }
+
+  void receive_from_client() {
+    auto buf = std::array<std::uint8_t, chunk_size>{};
+    const auto ret = read(client_fd, buf.data(), buf.size());
+    if (ret <= 0) {
+      if (ret == 0 || (errno != EAGAIN && errno != EINTR)) {
+        drop_client();
+      }
+      return;
+    }
+    const auto count = static_cast<std::size_t>(ret);
+    for (const auto byte : std::span{buf}.first(count)) {
+      parse(byte);
+    }
+    send_to_port();
+  }
+
+  void receive_from_port() {
+    auto buf = std::array<std::uint8_t, chunk_size>{};
+    const auto ret = conn->read_nonblocking(buf.data(), chunk_size);
+    if (ret < 0) {
+      failed = true;
+      drop_client();
+      return;
+    }
+    const auto count = static_cast<std::size_t>(ret);
+    for (const auto byte : std::span{buf}.first(count)) {
+      append_data(byte);
+    }
+    send_to_client();
+  }
+
+  // all data a client has sent at once is written at once
+  void send_to_port() {
+    if (to_port.empty()) {
+      return;
+    }
+    const auto ret = conn->write_nonblocking(to_port.data(),
+                                             static_cast<int>(to_port.size()));
+    if (ret < 0) {
+      failed = true;
+      drop_client();
+      return;
+    }
+    to_port.erase(to_port.begin(), to_port.begin() + ret);
+  }
+
+  void send_to_client() {
+    if (to_client.empty()) {
+      return;
+    }
+    const auto ret =
+        send(client_fd, to_client.data(), to_client.size(), MSG_NOSIGNAL);
+    if (ret < 0) {
+      if (errno != EAGAIN && errno != EINTR) {
+        drop_client();
+      }
+      return;
+    }
+    to_client.erase(to_client.begin(), to_client.begin() + ret);
+  }
+#endif
+
+  void append_data(const std::uint8_t byte) {
+    to_client.push_back(byte);
+    if (byte == telnet::iac) {
+      to_client.push_back(byte);
+    }
+  }
+
+  void negotiate(const std::uint8_t verb, const std::uint8_t option) {
+    to_client.insert(to_client.end(), {telnet::iac, verb, option});
+    // what is asked for is taken to be agreed, so that the answer to it is
+    // not answered in turn
+    if (verb == telnet::will) {
+      local[option] = true;
+    } else if (verb == telnet::do_) {
+      remote[option] = true;
+    }
+  }
+
+  void parse(const std::uint8_t byte) {
+    switch (state) {
+    case state_t::Data:
+      if (byte == telnet::iac) {
+        state = state_t::Iac;
+      } else {
+        to_port.push_back(byte);
+      }
+      break;
+    case state_t::Iac:
+      state = state_t::Data;
+      if (byte == telnet::iac) {
+        to_port.push_back(byte);
+      } else if (byte >= telnet::will && byte <= telnet::dont) {
+        verb = byte;
+        state = state_t::Option;
+      } else if (byte == telnet::sb) {
+        sub.clear();
+        state = state_t::Sub;
+      }
+      break;
+    case state_t::Option:
+      handle_option(byte);
+      state = state_t::Data;
+      break;
+    case state_t::Sub:
+      if (byte == telnet::iac) {
+        state = state_t::SubIac;
+      } else if (sub.size() < max_subnegotiation) {
+        sub.push_back(byte);
+      }
+      break;
+    case state_t::SubIac:
+      if (byte == telnet::iac) {
+        if (sub.size() < max_subnegotiation) {
+          sub.push_back(byte);
+        }
+        state = state_t::Sub;
+      } else {
+        if (byte == telnet::se && sub.size() >= 2U
+            && sub[0] == telnet::com_port) {
+          handle_command(static_cast<command_t>(sub[1]),
+                         std::span{sub}.subspan(2));
+        }
+        state = state_t::Data;
+      }
+      break;
+    }
+  }
+
+  // only changes of state are answered (RFC 854)
+  void handle_option(const std::uint8_t option) {
+    switch (verb) {
+    case telnet::will:
+      if (!is_supported(option)) {
+        to_client.insert(to_client.end(), {telnet::iac, telnet::dont, option});
+      } else if (!remote[option]) {
+        negotiate(telnet::do_, option);
+      }
+      break;
+    case telnet::wont:
+      if (remote[option]) {
+        remote[option] = false;
+        to_client.insert(to_client.end(), {telnet::iac, telnet::dont, option});
+      }
+      break;
+    case telnet::do_:
+      if (!is_supported(option) || option == telnet::com_port) {
+        to_client.insert(to_client.end(), {telnet::iac, telnet::wont, option});
+      } else if (!local[option]) {
+        negotiate(telnet::will, option);
+      }
+      break;
+    case telnet::dont:
+      if (local[option]) {
+        local[option] = false;
+        to_client.insert(to_client.end(), {telnet::iac, telnet::wont, option});
+      }
+      break;
+    default:
+      break;
+    }
+  }
+
+  void reply(const command_t command,
+             const std::span<const std::uint8_t> value) {
+    to_client.insert(to_client.end(),
+                     {telnet::iac, telnet::sb, telnet::com_port,
+                      static_cast<std::uint8_t>(static_cast<std::uint8_t>(
+                                                    command)
+                                                + server_offset)});
+    for (const auto byte : value) {
+      append_data(byte);
+    }
+    to_client.insert(to_client.end(), {telnet::iac, telnet::se});
+  }
+
+  void reply(const command_t command, const std::uint8_t value) {
+    reply(command, std::span{&value, 1U});
+  }
+
+  // settings are answered with what is in effect afterwards, a value of `0`
+  // merely asks for that
+  void handle_command(const command_t command,
+                      const std::span<const std::uint8_t> value) {
+    const auto first = value.empty() ? std::uint8_t{0} : value[0];
+    const auto current = [this] { return conn->get_config(); };
+    const auto or_zero = [](const int setting) {
+      return static_cast<std::uint8_t>(std::max(setting, 0));
+    };
+
+    switch (command) {
+    case command_t::Signature:
+      if (value.empty()) {
+        reply(command,
+              {reinterpret_cast<const std::uint8_t *>(signature.data()),
+               signature.size()});
+      }
+      break;
+    case command_t::SetBaudRate: {
+      if (value.size() < 4U) {
+        break;
+      }
+      const auto requested = (std::uint32_t{value[0]} << 24U)
+                             | (std::uint32_t{value[1]} << 16U)
+                             | (std::uint32_t{value[2]} << 8U) | value[3];
+      if (requested > 0U && requested <= 0x7fff'ffffU) {
+        conn->set_config({.baud_rate = static_cast<int>(requested)});
+      }
+      const auto baud_rate =
+          static_cast<std::uint32_t>(std::max(current().baud_rate, 0));
+      const auto encoded =
+          std::array{static_cast<std::uint8_t>(baud_rate >> 24U),
+                     static_cast<std::uint8_t>(baud_rate >> 16U),
+                     static_cast<std::uint8_t>(baud_rate >> 8U),
+                     static_cast<std::uint8_t>(baud_rate)};
+      reply(command, encoded);
+      break;
+    }
+    case command_t::SetDataSize:
+      if (first >= 5U && first <= 8U) {
+        conn->set_config({.bits = first});
+      }
+      reply(command, or_zero(current().bits));
+      break;
+    case command_t::SetParity:
+      // 1 (none) to 5 (space) map onto `parity_t` in order
+      if (first >= 1U && first <= 5U) {
+        conn->set_config({.parity = static_cast<parity_t>(first - 1)});
+      }
+      reply(command, or_zero(static_cast<int>(current().parity) + 1));
+      break;
+    case command_t::SetStopSize:
+      // 3 would be 1.5 stop bits, which libserialport does not offer
+      if (first == 1U || first == 2U) {
+        conn->set_config({.stop_bits = first});
+      }
+      reply(command, or_zero(current().stop_bits));
+      break;
+    case command_t::SetControl:
+      reply(command, set_control(first));
+      break;
+    case command_t::FlowControlSuspend:
+      suspended = true;
+      break;
+    case command_t::FlowControlResume:
+      suspended = false;
+      break;
+    case command_t::SetLineStateMask:
+    case command_t::SetModemStateMask:
+      // no notifications are sent, so there is nothing to mask
+      reply(command, first);
+      break;
+    case command_t::PurgeData:
+      if (first >= 1U && first <= 3U) {
+        conn->flush(static_cast<buffer_t>(first));
+        reply(command, first);
+      }
+      break;
+    }
+  }
+
+  std::uint8_t set_control(const std::uint8_t value) {
+    auto *const port = conn->get_port().get();
+    if (value >= control::flow_none && value <= control::flow_hardware) {
+      static constexpr auto modes =
+          std::array{SP_FLOWCONTROL_NONE, SP_FLOWCONTROL_XONXOFF,
+                     SP_FLOWCONTROL_RTSCTS};
+      if (sp_set_flowcontrol(port, modes[value - control::flow_none])
+          == SP_OK) {
+        flow_control = value;
+      }
+    } else if (value == control::break_on || value == control::break_off) {
+      const auto ret = value == control::break_on ? sp_start_break(port)
+                                                  : sp_end_break(port);
+      if (ret == SP_OK) {
+        breaking = value == control::break_on;
+      }
+    } else if (value == control::dtr_on || value == control::dtr_off) {
+      if (sp_set_dtr(port, value == control::dtr_on ? SP_DTR_ON : SP_DTR_OFF)
+          == SP_OK) {
+        dtr = value;
+      }
+    } else if (value == control::rts_on || value == control::rts_off) {
+      if (sp_set_rts(port, value == control::rts_on ? SP_RTS_ON : SP_RTS_OFF)
+          == SP_OK) {
+        rts = value;
+      }
+    }
+
+    if (value <= control::flow_hardware) {
+      return flow_control;
+    }
+    if (value <= control::break_off) {
+      return breaking ? control::break_on : control::break_off;
+    }
+    if (value <= control::dtr_off) {
+      return dtr;
+    }
+    if (value <= control::rts_off) {
+      return rts;
+    }
+    // inbound flow control follows the outbound setting in libserialport
+    if (value <= control::inbound_flow_last) {
+      return control::inbound_flow_none;
+    }
+    return 0U;
+  }
+
+  connection *conn;
+  int listen_fd;
+  int port_fd{-1};
+  int client_fd{-1};
+  bool failed{false};    // the port has failed, clients are turned away
+  bool suspended{false}; // the client has asked for no more data
+  bool breaking{false};
+  std::uint8_t flow_control{control::flow_none};
+  std::uint8_t dtr{control::dtr_on};
+  std::uint8_t rts{control::rts_on};
+  state_t state{state_t::Data};
+  std::uint8_t verb{0};
+  std::vector<std::uint8_t> sub;
+  std::array<bool, 256> local{}; // options enabled on the side of the server
+  std::array<bool, 256> remote{};
+  std::vector<std::uint8_t> to_port;   // decoded data from the client
+  std::vector<std::uint8_t> to_client; // encoded data and replies
+};
+
+sp::rfc2217_server::rfc2217_server() = default;
+
+sp::rfc2217_server::~rfc2217_server() = default;
+
+std::optional<std::uint16_t>
+sp::rfc2217_server::listen([[maybe_unused]] connection &conn,
+                           [[maybe_unused]] const std::uint16_t tcp_port,
+                           [[maybe_unused]] const char *const address) {
+#ifndef _WIN32
+  auto addr = sockaddr_in{};
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(tcp_port);
+  if (address == nullptr || inet_pton(AF_INET, address, &addr.sin_addr) != 1) {
+    return std::nullopt;
+  }
+  const auto fd =
+      socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return std::nullopt;
+  }
+  const auto on = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+  auto length = socklen_t{sizeof(addr)};
+  if (bind(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr)) != 0
+      || ::listen(fd, 1) != 0
+      || getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &length) != 0) {
+    close(fd);
+    return std::nullopt;
+  }
+  sessions_.push_back(std::make_unique<session>(conn, fd));
+  return ntohs(addr.sin_port);
+#else
+  return std::nullopt;
+#endif
+}
+
+sp::status_t sp::rfc2217_server::serve([[maybe_unused]] const long timeout_ms) {
+#ifndef _WIN32
+  if (timeout_ms < 0) {
+    return status_t::InvalidArgument;
+  }
+  // three slots per session: listener, client and port
+  auto fds = std::vector<pollfd>{};
+  fds.reserve(sessions_.size() * 3U);
+  for (const auto &s : sessions_) {
+    const auto has_client = s->client_fd >= 0;
+    fds.push_back({s->listen_fd, POLLIN, 0});
+    // a side is only read from once what it has sent has been passed on
+    fds.push_back(
+        {has_client ? s->client_fd : -1,
+         static_cast<short>((s->to_port.empty() ? POLLIN : 0)
+                            | (s->to_client.empty() ? 0 : POLLOUT)),
+         0});
+    fds.push_back(
+        {has_client && !s->failed ? s->port_fd : -1,
+         static_cast<short>(
+             (s->to_client.empty() && !s->suspended ? POLLIN : 0)
+             | (s->to_port.empty() ? 0 : POLLOUT)),
+         0});
+  }
+
+  const auto ret = poll(fds.data(), fds.size(),
+                        timeout_ms == 0 ? -1 : static_cast<int>(timeout_ms));
+  if (ret < 0) {
+    return errno == EINTR ? status_t::OK : status_t::SystemError;
+  }
+
+  constexpr auto readable = POLLIN | POLLHUP | POLLERR;
+  for (auto i = 0U; i < sessions_.size(); ++i) {
+    auto &s = *sessions_[i];
+    const auto *const slots = &fds[i * 3U];
+    if ((slots[0].revents & POLLIN) != 0) {
+      s.accept_client();
+    }
+    if (s.client_fd >= 0 && slots[1].fd == s.client_fd) {
+      if ((slots[1].revents & POLLOUT) != 0) {
+        s.send_to_client();
+      }
+      if ((slots[1].revents & readable) != 0 && s.client_fd >= 0) {
+        s.receive_from_client();
+      }
+    }
+    if (s.client_fd >= 0 && slots[2].fd == s.port_fd) {
+      if ((slots[2].revents & POLLOUT) != 0) {
+        s.send_to_port();
+      }
+      if ((slots[2].revents & readable) != 0 && s.client_fd >= 0) {
+        s.receive_from_port();
+      }
+    }
+    // replies and negotiation are sent right away
+    if (s.client_fd >= 0) {
+      s.send_to_client();
+    }
+  }
+  return status_t::OK;
+#else
+  return status_t::NotSupported;
+#endif
+}
+
+std::size_t sp::rfc2217_server::clients() const noexcept {
+  return static_cast<std::size_t>(
+      std::ranges::count_if(sessions_, [](const auto &s) {
+        return s->client_fd >= 0;
+      }));
+}
@@ -0,0 +1,293 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Shards connections across worker threads that are pinned to CPUs.
+
+#include <spp/sharded_runtime.hpp>
+
+#include "status.hpp"
+
+#include <algorithm>
+#include <array>
+#include <future>
+#include <thread>
+#include <utility>
+#include <variant>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+namespace {
+  constexpr auto read_chunk_size = 4'096;
+
+  struct add_t {
+    std::size_t id;
+    std::unique_ptr<sp::connection> conn;
+    sp::rx_handler_t on_data;
+  };
+
+  struct task_t {
+    std::size_t id;
+    sp::port_task_t task;
+  };
+
+  struct remove_t {
+    std::size_t id;
+  };
+
+  using message_t = std::variant<add_t, task_t, remove_t>;
+
+  struct port_entry {
+    std::size_t id;
+    std::unique_ptr<sp::connection> conn;
+    sp::rx_handler_t on_data;
+    int fd;
+    bool failed;
+  };
+
+  // pins the calling thread
+  sp::status_t pin_to_cpu([[maybe_unused]] const int cpu) {
+#ifdef __linux__
+    if (cpu < 0 || cpu >= CPU_SETSIZE) {
+      return sp::status_t::InvalidArgument;
+    }
+    auto set = cpu_set_t{};
+    CPU_ZERO(&set);
+    CPU_SET(static_cast<unsigned>(cpu), &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0
+               ? sp::status_t::OK
+               : sp::status_t::SystemError;
+#else
+    return sp::status_t::NotSupported;
+#endif
+  }
+} // namespace
+
+struct sp::sharded_runtime::shard {
+  explicit shard(std::size_t queue_capacity) : inbox{queue_capacity} {
+#ifndef _WIN32
+    if (pipe(wake_fds.data()) != 0) {
+      wake_fds = {-1, -1};
+      return;
+    }
+    for (const auto fd : wake_fds) {
+      fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+    }
+#endif
+  }
+
+  // returns whether the worker can be woken up
+  bool is_valid() const noexcept { return wake_fds[0] >= 0; }
+
+  ~shard() {
+    // the pipe must outlive the worker
+    worker.request_stop();
+    if (worker.joinable()) {
+      worker.join();
+    }
+#ifndef _WIN32
+    for (const auto fd : wake_fds) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+#endif
+  }
+
+  shard(const shard &) = delete;
+  shard &operator=(const shard &) = delete;
+
+  shard(shard &&) = delete;
+  shard &operator=(shard &&) = delete;
+
+  bool send(message_t &&message) {
+    if (!inbox.try_push(std::move(message))) {
+      return false;
+    }
+    // pairs with the fence in `run`, so that either the worker sees the
+    // message or this sees the worker sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // only a worker that is about to sleep needs waking
+    if (sleeping.exchange(false)) {
+      wake();
+    }
+    return true;
+  }
+
+  void wake() {
+#ifndef _WIN32
+    const auto byte = char{0};
+    (void)write(wake_fds[1], &byte, 1);
+#endif
+  }
+
+  void handle(message_t &message) {
+    if (auto *const add = std::get_if<add_t>(&message)) {
+      auto fd = -1;
+      get_native_handle(add->conn->get_port(), &fd);
+      ports.push_back(
+          {add->id, std::move(add->conn), std::move(add->on_data), fd, false});
+      ports_changed = true;
+    } else if (auto *const task = std::get_if<task_t>(&message)) {
+      const auto it = std::ranges::find(ports, task->id, &port_entry::id);
+      if (it != ports.end()) {
+        task->task(*it->conn);
+      }
+    } else if (const auto *const remove = std::get_if<remove_t>(&message)) {
+      std::erase_if(ports, [id = remove->id](const port_entry &port) {
+        return port.id == id;
+      });
+      ports_changed = true;
+    }
+  }
+
+  void run(const std::stop_token &stop) {
+#ifndef _WIN32
+    const auto on_stop = std::stop_callback{stop, [this] { wake(); }};
+    // slot `0` is the wakeup pipe, followed by the ports in order
+    auto fds = std::vector<pollfd>{};
+    auto buf = std::array<std::byte, read_chunk_size>{};
+
+    while (!stop.stop_requested()) {
+      while (auto message = inbox.try_pop()) {
+        handle(*message);
+      }
+      if (ports_changed) {
+        fds.clear();
+        fds.push_back({wake_fds[0], POLLIN, 0});
+        for (const auto &port : ports) {
+          fds.push_back({port.fd, POLLIN, 0});
+        }
+        ports_changed = false;
+      }
+
+      // anything handed over after this is followed by a wakeup
+      sleeping.store(true);
+      // pairs with the fence in `send`, the queue itself only acquires
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!inbox.empty() || stop.stop_requested()) {
+        sleeping.store(false);
+        continue;
+      }
+      const auto ready = poll(fds.data(), fds.size(), -1);
+      sleeping.store(false);
+      if (ready <= 0) {
+        continue;
+      }
+
+      if (fds[0].revents != 0) {
+        auto drain = std::array<char, 64>{};
+        while (read(wake_fds[0], drain.data(), drain.size()) > 0) {
+        }
+      }
+      for (auto i = std::size_t{1}; i < fds.size(); ++i) {
+        if (fds[i].revents == 0) {
+          continue;
+        }
+        auto &port = ports[i - 1U];
+        const auto ret = port.conn->read_nonblocking(buf.data(), buf.size());
+        if (ret > 0) {
+          port.on_data(*port.conn,
+                       std::span{buf}.first(static_cast<std::size_t>(ret)));
+        } else if (ret < 0 || (fds[i].revents & (POLLERR | POLLHUP)) != 0) {
+          port.on_data(*port.conn, {});
+          port.failed = true;
+          ports_changed = true;
+        }
+      }
+      std::erase_if(ports, &port_entry::failed);
+    }
+#endif
+  }
+
+  handoff_queue<message_t> inbox;
+  std::atomic<bool> sleeping{false};
+  std::array<int, 2> wake_fds{-1, -1};
+  status_t affinity{status_t::NotSupported};
+
+  // only touched by the worker
+  std::vector<port_entry> ports;
+  bool ports_changed{true};
+
+  std::jthread worker; // started last
+};
+
+sp::sharded_runtime::sharded_runtime(const std::span<const int> cpus,
+                                     const std::size_t queue_capacity) {
+#ifdef _WIN32
+  // there is no way to wait for ports and a wakeup at once, so no workers are
+  // started and `add` fails
+  (void)cpus;
+  (void)queue_capacity;
+  status_ = status_t::NotSupported;
+#else
+  for (const auto cpu : cpus) {
+    auto &s = *shards_.emplace_back(std::make_unique<shard>(queue_capacity));
+    if (!s.is_valid()) {
+      // a worker that cannot be woken up would not be of use, so none are
+      shards_.clear();
+      status_ = status_t::SystemError;
+      return;
+    }
+    auto pinned = std::promise<status_t>{};
+    auto affinity = pinned.get_future();
+    s.worker = std::jthread{[&s, cpu, pinned = std::move(pinned)](
+                                const std::stop_token &stop) mutable {
+      // before any work is taken on
+      pinned.set_value(cpu >= 0 ? pin_to_cpu(cpu) : status_t::NotSupported);
+      s.run(stop);
+    }};
+    s.affinity = affinity.get();
+  }
+#endif
+}
+
+sp::sharded_runtime::~sharded_runtime() = default;
+
+std::size_t sp::sharded_runtime::shards() const noexcept {
+  return shards_.size();
+}
+
+sp::status_t sp::sharded_runtime::get_status() const noexcept {
+  return status_;
+}
+
+sp::status_t
+sp::sharded_runtime::get_affinity_status(const std::size_t shard) const {
+  return shard < shards_.size() ? shards_[shard]->affinity
+                                : status_t::InvalidArgument;
+}
+
+std::optional<std::size_t> sp::sharded_runtime::add(connection conn,
+                                                    rx_handler_t on_data) {
+  if (shards_.empty()) {
+    detail::set_status(status_ != status_t::OK ? status_
+                                               : status_t::InvalidArgument);
+    return std::nullopt;
+  }
+  const auto id = next_id_.fetch_add(1U);
+  if (!shards_[shard_of(id)]->send(
+          add_t{id, std::make_unique<connection>(std::move(conn)),
+                std::move(on_data)})) {
+    return std::nullopt;
+  }
+  return id;
+}
+
+std::size_t
+sp::sharded_runtime::shard_of(const std::size_t port_id) const noexcept {
+  return shards_.empty() ? 0U : port_id % shards_.size();
+}
+
+bool sp::sharded_runtime::post(const std::size_t port_id, port_task_t task) {
+  return !shards_.empty()
+         && shards_[shard_of(port_id)]->send(task_t{port_id, std::move(task)});
+}
+
+bool sp::sharded_runtime::remove(const std::size_t port_id) {
+  return !shards_.empty()
+         && shards_[shard_of(port_id)]->send(remove_t{port_id});
+}
@@ -0,0 +1,18 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Gives the translation units of the library access to the status of the last
+// call on the calling thread.
+
+#ifndef SPP_STATUS_HPP_INCLUDED
+#define SPP_STATUS_HPP_INCLUDED
+
+#include <libserialport.hpp>
+
+namespace sp::detail {
+
+  // sets what `get_status` returns, and returns `status` for convenience
+  status_t set_status(status_t status) noexcept;
+
+} // namespace sp::detail
+
+#endif // SPP_STATUS_HPP_INCLUDED
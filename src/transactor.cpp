@@ -0,0 +1,302 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Carries out request/response transactions on a connection.
+
+#include <spp/transactor.hpp>
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <utility>
+
+namespace {
+  using std::chrono::steady_clock;
+
+  constexpr auto read_chunk_size = 256;
+
+  // a timeout of `0` never expires
+  steady_clock::time_point deadline_after(const long timeout_ms) {
+    return timeout_ms > 0
+               ? steady_clock::now() + std::chrono::milliseconds{timeout_ms}
+               : steady_clock::time_point::max();
+  }
+
+  // the matchers do not look at the requests, so they serve any allocator
+  auto match_terminated_by(const std::byte terminator) {
+    return [terminator](const std::span<const std::byte> received,
+                        [[maybe_unused]] const auto outstanding) {
+      const auto it = std::ranges::find(received, terminator);
+      if (it == received.end()) {
+        return sp::match_t{};
+      }
+      return sp::match_t{
+          .length = static_cast<std::size_t>(it - received.begin()) + 1U,
+          .request = 0U};
+    };
+  }
+
+  auto match_fixed_length(const std::size_t length) {
+    return [length](const std::span<const std::byte> received,
+                    [[maybe_unused]] const auto outstanding) {
+      return received.size() >= length
+                 ? sp::match_t{.length = length, .request = 0U}
+                 : sp::match_t{};
+    };
+  }
+} // namespace
+
+sp::matcher_t sp::terminated_by(const std::byte terminator) {
+  return match_terminated_by(terminator);
+}
+
+sp::matcher_t sp::fixed_length(const std::size_t length) {
+  return match_fixed_length(length);
+}
+
+sp::pmr::matcher_t sp::pmr::terminated_by(const std::byte terminator) {
+  return match_terminated_by(terminator);
+}
+
+sp::pmr::matcher_t sp::pmr::fixed_length(const std::size_t length) {
+  return match_fixed_length(length);
+}
+
+template <typename Allocator>
+sp::basic_transactor<Allocator>::basic_transactor(
+    connection &conn, matcher_type matcher, const std::size_t max_in_flight,
+    const Allocator &alloc)
+    : conn_{&conn}, alloc_{alloc}, matcher_{std::move(matcher)},
+      max_in_flight_{std::max(max_in_flight, std::size_t{1})},
+      queued_{alloc}, outstanding_{alloc}, in_flight_{alloc}, rx_{alloc},
+      tx_{alloc} {}
+
+template <typename Allocator>
+std::uint64_t sp::basic_transactor<Allocator>::submit(
+    const std::span<const std::byte> request,
+    const steady_clock::time_point deadline) {
+  const auto id = next_id_++;
+  const auto pos = std::ranges::upper_bound(queued_, deadline, {},
+                                            &request_type::deadline);
+  queued_.insert(pos,
+                 {id, {request.begin(), request.end(), alloc_}, deadline});
+  return id;
+}
+
+template <typename Allocator>
+sp::status_t
+sp::basic_transactor<Allocator>::process(vector_type<response_type> &finished,
+                                         const long timeout_ms) {
+  if (timeout_ms < 0) {
+    return status_t::InvalidArgument;
+  }
+  const auto until = deadline_after(timeout_ms);
+  const auto initial_count = finished.size();
+  auto buf = std::array<std::byte, read_chunk_size>{};
+
+  // requests that expired in flight are not waited for
+  const auto is_live = [this] {
+    return !queued_.empty()
+           || std::ranges::any_of(in_flight_, [](const auto &f) {
+                return !f.expired;
+              });
+  };
+
+  while (is_live()) {
+    expire(finished);
+    send(finished);
+    match(finished);
+    if (finished.size() != initial_count || !is_live()
+        || steady_clock::now() >= until) {
+      break;
+    }
+
+    const auto wait_ms = wait_time_ms(until);
+    const auto ret = conn_->read_next_blocking(buf.data(), buf.size(), wait_ms);
+    if (ret < 0) {
+      return get_status();
+    }
+    rx_.insert(rx_.end(), buf.begin(), buf.begin() + ret);
+    match(finished);
+    if (finished.size() != initial_count) {
+      break;
+    }
+  }
+  return status_t::OK;
+}
+
+template <typename Allocator>
+typename sp::basic_transactor<Allocator>::response_type
+sp::basic_transactor<Allocator>::transact(
+    const std::span<const std::byte> request, const long timeout_ms) {
+  const auto id = submit(request, deadline_after(timeout_ms));
+  auto finished = vector_type<response_type>{alloc_};
+  while (true) {
+    if (const auto status = process(finished, timeout_ms);
+        status != status_t::OK) {
+      return {id, status, false, {}, {}};
+    }
+    const auto it = std::ranges::find(finished, id, &response_type::id);
+    if (it != finished.end()) {
+      return std::move(*it);
+    }
+  }
+}
+
+template <typename Allocator>
+std::size_t sp::basic_transactor<Allocator>::pending() const noexcept {
+  // requests that expired in flight have been reported already
+  return queued_.size()
+         + static_cast<std::size_t>(std::ranges::count_if(
+             in_flight_, [](const auto &f) { return !f.expired; }));
+}
+
+template <typename Allocator>
+sp::status_t sp::basic_transactor<Allocator>::reset() {
+  outstanding_.clear();
+  in_flight_.clear();
+  rx_.clear();
+  return conn_->flush(buffer_t::Rx);
+}
+
+template <typename Allocator>
+const sp::latency_stats_t &
+sp::basic_transactor<Allocator>::latencies() const noexcept {
+  return latencies_;
+}
+
+template <typename Allocator>
+void sp::basic_transactor<Allocator>::expire(
+    vector_type<response_type> &finished) {
+  const auto now = steady_clock::now();
+
+  const auto first_alive = std::ranges::find_if(
+      queued_, [now](const auto &req) { return req.deadline > now; });
+  for (auto it = queued_.begin(); it != first_alive; ++it) {
+    finished.push_back({it->id, status_t::OK, true, {}, {}});
+  }
+  queued_.erase(queued_.begin(), first_alive);
+
+  for (auto i = std::size_t{0}; i < outstanding_.size();) {
+    auto &f = in_flight_[i];
+    if (!f.expired && outstanding_[i].deadline <= now) {
+      f.expired = true;
+      // waits as long again for a late response before freeing the slot, so
+      // that a lost response does not keep it taken for good
+      f.forget_at = now + (now - f.sent_at);
+      finished.push_back(
+          {outstanding_[i].id, status_t::OK, true, {}, now - f.sent_at});
+    }
+    if (f.expired && f.forget_at <= now) {
+      outstanding_.erase(outstanding_.begin() + static_cast<long>(i));
+      in_flight_.erase(in_flight_.begin() + static_cast<long>(i));
+      continue;
+    }
+    ++i;
+  }
+}
+
+template <typename Allocator>
+void sp::basic_transactor<Allocator>::send(
+    vector_type<response_type> &finished) {
+  const auto count = std::min(queued_.size(),
+                              max_in_flight_ - std::min(max_in_flight_,
+                                                        outstanding_.size()));
+  if (count == 0U) {
+    return;
+  }
+
+  // requests are written in one go, saving a wakeup per request
+  const auto first = queued_.begin();
+  const auto last = first + static_cast<long>(count);
+  tx_.clear();
+  for (auto it = first; it != last; ++it) {
+    tx_.insert(tx_.end(), it->data.begin(), it->data.end());
+  }
+  const auto ret = tx_.empty()
+                       ? 0
+                       : conn_->write_blocking(
+                             tx_.data(), static_cast<int>(tx_.size()),
+                             wait_time_ms(queued_.front().deadline));
+  const auto sent_at = steady_clock::now();
+
+  if (ret == static_cast<int>(tx_.size())) {
+    for (auto it = first; it != last; ++it) {
+      in_flight_.push_back({sent_at, false, {}});
+    }
+    outstanding_.insert(outstanding_.end(), std::make_move_iterator(first),
+                        std::make_move_iterator(last));
+  } else {
+    // whatever made it out is incomplete, so none of the requests are answered
+    const auto status = ret < 0 ? get_status() : status_t::OK;
+    for (auto it = first; it != last; ++it) {
+      finished.push_back({it->id, status, ret >= 0, {}, {}});
+    }
+  }
+  queued_.erase(first, last);
+}
+
+template <typename Allocator>
+void sp::basic_transactor<Allocator>::match(
+    vector_type<response_type> &finished) {
+  auto consumed = std::size_t{0};
+  while (consumed < rx_.size()) {
+    const auto received = std::span{rx_}.subspan(consumed);
+    const auto m = matcher_(received, outstanding_);
+    if (m.length == 0U) {
+      break;
+    }
+    const auto length = std::min(m.length, received.size());
+
+    if (m.request < outstanding_.size()) {
+      const auto index = static_cast<long>(m.request);
+      if (!in_flight_[m.request].expired) {
+        const auto round_trip =
+            steady_clock::now() - in_flight_[m.request].sent_at;
+        finished.push_back({outstanding_[m.request].id,
+                            status_t::OK,
+                            false,
+                            {received.begin(),
+                             received.begin() + static_cast<long>(length),
+                             alloc_},
+                            round_trip});
+        ++latencies_.count;
+        latencies_.min = std::min(latencies_.min, finished.back().round_trip);
+        latencies_.max = std::max(latencies_.max, finished.back().round_trip);
+        latencies_.total += finished.back().round_trip;
+      }
+      outstanding_.erase(outstanding_.begin() + index);
+      in_flight_.erase(in_flight_.begin() + index);
+    }
+    consumed += length;
+  }
+  rx_.erase(rx_.begin(), rx_.begin() + static_cast<long>(consumed));
+}
+
+template <typename Allocator>
+long sp::basic_transactor<Allocator>::wait_time_ms(
+    const steady_clock::time_point until) const {
+  auto wake = until;
+  for (auto i = 0U; i < outstanding_.size(); ++i) {
+    if (!in_flight_[i].expired) {
+      wake = std::min(wake, outstanding_[i].deadline);
+    }
+  }
+  if (!queued_.empty() && outstanding_.size() >= max_in_flight_) {
+    wake = std::min(wake, queued_.front().deadline);
+    // a slot is freed once a request that expired in flight is forgotten
+    for (const auto &f : in_flight_) {
+      if (f.expired) {
+        wake = std::min(wake, f.forget_at);
+      }
+    }
+  }
+  if (wake == steady_clock::time_point::max()) {
+    return 0; // waits indefinitely
+  }
+  const auto remaining = std::chrono::ceil<std::chrono::milliseconds>(
+      wake - steady_clock::now());
+  return std::max(1L, static_cast<long>(remaining.count()));
+}
+
+template class sp::basic_transactor<std::allocator<std::byte>>;
+template class sp::basic_transactor<std::pmr::polymorphic_allocator<std::byte>>;
@@ -0,0 +1,287 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Queues writes to a connection and drains them in the background.
+
+#include <spp/write_queue.hpp>
+
+#include <libserialport.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <memory>
+
+namespace {
+  // the longest the drainer sleeps or waits before checking for a stop
+  constexpr auto max_wait = std::chrono::milliseconds{10};
+} // namespace
+
+sp::write_queue::write_queue(connection &conn, write_queue_options_t options,
+                             std::pmr::memory_resource *const resource)
+    : conn_{&conn}, resource_{resource}, options_{options},
+      ring_(std::max(options.capacity, std::size_t{1}), resource),
+      deferred_{resource},
+      drainer_{[this](const std::stop_token &stop) { run(stop); }} {}
+
+sp::write_queue::~write_queue() {
+  drainer_.request_stop();
+  drainer_.join();
+  for (auto &d : deferred_) {
+    d.queued.set_value(-1);
+  }
+}
+
+int sp::write_queue::write_blocking(const std::span<const std::byte> data,
+                                    const long timeout_ms) {
+  if (data.size() > ring_.size() || timeout_ms < 0) {
+    return -1;
+  }
+  auto lock = std::unique_lock{mutex_};
+  const auto is_ready = [this, &data] {
+    return status_ != status_t::OK || (deferred_.empty() && fits(data.size()));
+  };
+  if (timeout_ms > 0) {
+    if (!changed_.wait_for(lock, std::chrono::milliseconds{timeout_ms},
+                           is_ready)) {
+      return 0;
+    }
+  } else {
+    changed_.wait(lock, is_ready);
+  }
+  if (status_ != status_t::OK) {
+    return -1;
+  }
+  const auto high = push(data);
+  lock.unlock();
+  changed_.notify_all();
+  if (high) {
+    notify();
+  }
+  return static_cast<int>(data.size());
+}
+
+int sp::write_queue::write_nonblocking(const std::span<const std::byte> data) {
+  if (data.size() > ring_.size()) {
+    return -1;
+  }
+  auto lock = std::unique_lock{mutex_};
+  if (status_ != status_t::OK) {
+    return -1;
+  }
+  if (!deferred_.empty() || !fits(data.size())) {
+    return 0;
+  }
+  const auto high = push(data);
+  lock.unlock();
+  changed_.notify_all();
+  if (high) {
+    notify();
+  }
+  return static_cast<int>(data.size());
+}
+
+std::future<int>
+sp::write_queue::write_async(const std::span<const std::byte> data) {
+  auto queued = std::promise<int>{std::allocator_arg,
+                                  std::pmr::polymorphic_allocator<>{resource_}};
+  auto result = queued.get_future();
+  if (data.size() > ring_.size()) {
+    queued.set_value(-1);
+    return result;
+  }
+  auto lock = std::unique_lock{mutex_};
+  if (status_ != status_t::OK) {
+    queued.set_value(-1);
+    return result;
+  }
+  if (!deferred_.empty() || !fits(data.size())) {
+    deferred_.push_back(
+        {{data.begin(), data.end(), resource_}, std::move(queued)});
+    return result;
+  }
+  const auto high = push(data);
+  lock.unlock();
+  changed_.notify_all();
+  if (high) {
+    notify();
+  }
+  queued.set_value(static_cast<int>(data.size()));
+  return result;
+}
+
+bool sp::write_queue::drain(const long timeout_ms) {
+  auto lock = std::unique_lock{mutex_};
+  const auto is_done = [this] {
+    return status_ != status_t::OK || (size_ == 0U && deferred_.empty());
+  };
+  if (timeout_ms > 0) {
+    changed_.wait_for(lock, std::chrono::milliseconds{timeout_ms}, is_done);
+  } else {
+    changed_.wait(lock, is_done);
+  }
+  return size_ == 0U && deferred_.empty();
+}
+
+sp::status_t sp::write_queue::get_status() const {
+  const auto lock = std::lock_guard{mutex_};
+  return status_;
+}
+
+std::size_t sp::write_queue::size() const {
+  const auto lock = std::lock_guard{mutex_};
+  return size_;
+}
+
+void sp::write_queue::on_high_watermark(std::function<void()> fn) {
+  const auto lock = std::lock_guard{mutex_};
+  on_high_ = std::move(fn);
+}
+
+void sp::write_queue::on_low_watermark(std::function<void()> fn) {
+  const auto lock = std::lock_guard{mutex_};
+  on_low_ = std::move(fn);
+}
+
+bool sp::write_queue::fits(const std::size_t size) const noexcept {
+  return size_ + size <= ring_.size();
+}
+
+// returns whether the high watermark has been crossed
+bool sp::write_queue::push(const std::span<const std::byte> data) {
+  const auto tail = (head_ + size_) % ring_.size();
+  const auto first = std::min(data.size(), ring_.size() - tail);
+  std::memcpy(ring_.data() + tail, data.data(), first);
+  std::memcpy(ring_.data(), data.data() + first, data.size() - first);
+  size_ += data.size();
+  if (!above_high_ && size_ > options_.high_watermark) {
+    above_high_ = true;
+    ++crossings_;
+    return true;
+  }
+  return false;
+}
+
+// returns whether the low watermark has been reached
+bool sp::write_queue::pop(const std::size_t size) {
+  head_ = (head_ + size) % ring_.size();
+  size_ -= size;
+  if (above_high_ && size_ <= options_.low_watermark) {
+    above_high_ = false;
+    ++crossings_;
+    return true;
+  }
+  return false;
+}
+
+// returns whether the high watermark has been crossed
+bool sp::write_queue::admit_deferred() {
+  auto high = false;
+  while (!deferred_.empty() && fits(deferred_.front().data.size())) {
+    auto &d = deferred_.front();
+    high = push(d.data) || high;
+    d.queued.set_value(static_cast<int>(d.data.size()));
+    deferred_.pop_front();
+  }
+  return high;
+}
+
+// calls the callbacks for the watermarks crossed since the last call
+// producers and the drainer cross them concurrently, so the callbacks are
+// called by one thread at a time, in the order in which they were crossed
+void sp::write_queue::notify() {
+  const auto delivering = std::lock_guard{notify_mutex_};
+  while (true) {
+    auto lock = std::unique_lock{mutex_};
+    if (delivered_ == crossings_) {
+      return;
+    }
+    // the high watermark is crossed first, and then each in turn
+    const auto fn = delivered_ % 2U == 0U ? on_high_ : on_low_;
+    ++delivered_;
+    lock.unlock();
+    if (fn) {
+      fn();
+    }
+  }
+}
+
+// returns how many bytes the driver may be handed without its output buffer
+// exceeding the limit, sleeping for a while if that is none
+std::size_t sp::write_queue::allowance(const long character_time_us) {
+  if (options_.max_output_waiting < 0) {
+    return ring_.size();
+  }
+  const auto waiting = std::max(conn_->output_waiting(), 0);
+  const auto excess = waiting - options_.max_output_waiting;
+  if (excess < 0) {
+    return static_cast<std::size_t>(-excess);
+  }
+  // until the excess has been transmitted
+  std::this_thread::sleep_for(std::min<std::chrono::microseconds>(
+      std::chrono::microseconds{(excess + 1L) * character_time_us},
+      max_wait));
+  return 0U;
+}
+
+void sp::write_queue::run(const std::stop_token &stop) {
+  sp_event_set *events_raw_ptr = nullptr;
+  if (sp_new_event_set(&events_raw_ptr) != SP_OK) {
+    const auto lock = std::lock_guard{mutex_};
+    status_ = status_t::SystemError;
+    return;
+  }
+  const auto events = std::unique_ptr<sp_event_set, void (*)(sp_event_set *)>{
+      events_raw_ptr, sp_free_event_set};
+  sp_add_port_events(events.get(), conn_->get_port().get(), SP_EVENT_TX_READY);
+
+  const auto cfg_character_time_us = character_time_us(conn_->get_config());
+  const auto char_time_us =
+      cfg_character_time_us > 0 ? cfg_character_time_us : 100L;
+
+  while (!stop.stop_requested()) {
+    auto chunk = std::size_t{0};
+    auto head = std::size_t{0};
+    {
+      auto lock = std::unique_lock{mutex_};
+      if (!changed_.wait(lock, stop, [this] { return size_ > 0U; })) {
+        return;
+      }
+      head = head_;
+      chunk = std::min(size_, ring_.size() - head_);
+    }
+
+    chunk = std::min(chunk, allowance(char_time_us));
+    if (chunk == 0U) {
+      continue;
+    }
+
+    // producers only ever write behind the data that is queued, so the
+    // chunk can be written without holding the lock
+    const auto ret = conn_->write_nonblocking(ring_.data() + head,
+                                              static_cast<int>(chunk));
+    if (ret < 0) {
+      auto lock = std::unique_lock{mutex_};
+      status_ = sp::get_status();
+      for (auto &d : deferred_) {
+        d.queued.set_value(-1);
+      }
+      deferred_.clear();
+      lock.unlock();
+      changed_.notify_all();
+      return;
+    }
+    if (ret == 0) {
+      sp_wait(events.get(), static_cast<unsigned>(max_wait.count()));
+      continue;
+    }
+
+    auto lock = std::unique_lock{mutex_};
+    const auto low = pop(static_cast<std::size_t>(ret));
+    const auto high = admit_deferred();
+    lock.unlock();
+    changed_.notify_all();
+    if (high || low) {
+      notify();
+    }
+  }
+}
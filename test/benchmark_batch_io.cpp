@@ -0,0 +1,85 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Benchmarks reading from many ports through `sp::batch_io`, once through
+// io_uring (if enabled) and once through libserialport's event sets.
+// The ports are pseudo terminals behind mocked ports.
+
+#include <libserialport.hpp>
+#include <spp/batch_io.hpp>
+
+#include "libserialport_mock.hpp"
+#include "pty.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+namespace {
+  constexpr auto number_of_ports = 64U;
+  constexpr auto chunk_size = 16;
+
+  struct ports_t {
+    std::vector<sp_test::pty> ptys;
+    std::vector<sp::connection> conns;
+    std::vector<std::array<std::byte, chunk_size>> buffers;
+
+    ports_t() : buffers(number_of_ports) {
+      for (auto i = 0U; i < number_of_ports; ++i) {
+        auto &pty = ptys.emplace_back();
+        const auto port = sp::get_port_by_name("");
+        sp_mock::set_native_handle(port, pty.port());
+        conns.emplace_back(port, sp::mode_t::ReadWrite);
+      }
+    }
+  };
+
+  // every device sends a chunk, which is then read from all ports
+  int transfer_round(sp::batch_io &io, ports_t &ports) {
+    const auto chunk = std::array<char, chunk_size>{"0123456789abcde"};
+    for (const auto &pty : ports.ptys) {
+      (void)::write(pty.device(), chunk.data(), chunk.size());
+    }
+
+    auto bytes_read = 0;
+    for (auto i = 0U; i < number_of_ports; ++i) {
+      io.read(ports.conns[i], ports.buffers[i], i);
+    }
+    auto completions = std::vector<sp::completion_t>{};
+    while (io.pending() > 0U) {
+      completions.clear();
+      if (io.wait(completions, 1'000) != sp::status_t::OK
+          || completions.empty()) {
+        break;
+      }
+      for (const auto &c : completions) {
+        bytes_read += c.result;
+        // chunks may arrive in pieces
+        if (c.result > 0 && c.result < chunk_size
+            && ports.conns[c.user_data].input_waiting() > 0) {
+          io.read(ports.conns[c.user_data], ports.buffers[c.user_data],
+                  c.user_data);
+        }
+      }
+    }
+    return bytes_read;
+  }
+} // namespace
+
+TEST_CASE("reading from many ports at once") {
+  auto ports = ports_t{};
+
+  for (const auto use_io_uring : {true, false}) {
+    auto io = sp::batch_io{number_of_ports, use_io_uring};
+    if (use_io_uring && !io.is_accelerated()) {
+      continue;
+    }
+    REQUIRE(transfer_round(io, ports) == number_of_ports * chunk_size);
+
+    BENCHMARK(io.is_accelerated() ? "io_uring" : "event sets") {
+      return transfer_round(io, ports);
+    };
+  }
+}
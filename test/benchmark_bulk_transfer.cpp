@@ -0,0 +1,70 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Benchmarks sending a file through each protocol over a pseudo terminal.
+// The image is sent in full every time, so that the throughput of the
+// protocols can be compared; pseudo terminals do not limit the baud rate.
+
+#include <libserialport.hpp>
+#include <spp/bulk_transfer.hpp>
+
+#include "libserialport_mock.hpp"
+#include "pty.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstddef>
+#include <future>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+  constexpr auto image_size = std::size_t{256U * 1'024U};
+} // namespace
+
+TEST_CASE("sending a file through each protocol") {
+  auto pty = sp_test::pty{};
+  const auto port_tx = sp::get_port_by_name("");
+  const auto port_rx = sp::get_port_by_name("");
+  sp_mock::set_native_handle(port_tx, pty.port());
+  sp_mock::set_native_handle(port_rx, pty.device());
+  auto tx = sp::connection{port_tx, sp::mode_t::ReadWrite};
+  auto rx = sp::connection{port_rx, sp::mode_t::ReadWrite};
+
+  auto image = std::vector<std::byte>(image_size);
+  for (auto i = 0U; i < image.size(); ++i) {
+    image[i] = std::byte(static_cast<unsigned char>(i * 31U));
+  }
+  auto received = std::vector<std::byte>{};
+  received.reserve(image_size + 1'024U);
+
+  const auto transfer = [&](const sp::transfer_options_t &options) {
+    received.clear();
+    auto receiver = std::async(std::launch::async, [&] {
+      return sp::receive(rx, received, options);
+    });
+    const auto sent = sp::send(tx, image, "image.bin", options);
+    const auto got = receiver.get();
+    return sent.error == sp::transfer_error_t::None
+           && got.error == sp::transfer_error_t::None;
+  };
+
+  const auto cases =
+      std::vector<std::pair<std::string, sp::transfer_options_t>>{
+          {"XMODEM-1K", {.protocol = sp::transfer_protocol_t::XModem1K}},
+          {"YMODEM", {.protocol = sp::transfer_protocol_t::YModem}},
+          {"YMODEM-g",
+           {.protocol = sp::transfer_protocol_t::YModem, .streaming = true}},
+          {"ZMODEM, 16 KiB window",
+           {.protocol = sp::transfer_protocol_t::ZModem, .window = 16'384U}},
+          {"ZMODEM, no window",
+           {.protocol = sp::transfer_protocol_t::ZModem, .window = 0U}}};
+
+  for (const auto &[name, options] : cases) {
+    BENCHMARK(name + ", 256 KiB") {
+      return transfer(options);
+    };
+    CHECK(transfer(options));
+  }
+}
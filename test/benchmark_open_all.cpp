@@ -0,0 +1,59 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Benchmarks opening and configuring many ports at startup, once one after
+// another and once through `sp::open_all`.
+// The ports are pseudo terminals behind mocked ports, which take as long to
+// open as a slow USB adapter might.
+
+#include <libserialport.hpp>
+#include <spp/bulk_open.hpp>
+
+#include "libserialport_mock.hpp"
+#include "pty.hpp"
+
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace {
+  constexpr auto number_of_ports = 200U;
+  constexpr auto open_delay = std::chrono::microseconds{500};
+  constexpr auto cfg = sp::port_config_t{.baud_rate = 115'200,
+                                         .bits = 8,
+                                         .stop_bits = 1,
+                                         .parity = sp::parity_t::None};
+} // namespace
+
+TEST_CASE("opening many ports at startup") {
+  auto ptys = std::vector<sp_test::pty>(number_of_ports);
+  auto ports = std::vector<sp::port_t>{};
+  for (const auto &pty : ptys) {
+    ports.push_back(sp::get_port_by_name(""));
+    sp_mock::set_native_handle(ports.back(), pty.port());
+  }
+  sp_mock::set_open_delay(open_delay);
+
+  BENCHMARK("one after another") {
+    auto conns = std::vector<sp::connection>{};
+    for (const auto &port : ports) {
+      conns.emplace_back(port, sp::mode_t::ReadWrite, cfg);
+    }
+    return conns.size();
+  };
+
+  for (const auto workers : {4U, 16U, 64U}) {
+    BENCHMARK("open_all, " + std::to_string(workers) + " workers") {
+      return sp::open_all(ports, sp::mode_t::ReadWrite, cfg, workers).size();
+    };
+  }
+
+  const auto results = sp::open_all(ports, sp::mode_t::ReadWrite, cfg);
+  CHECK(std::ranges::all_of(results, [](const sp::open_result_t &r) {
+    return r.status == sp::status_t::OK;
+  }));
+  sp_mock::set_open_delay({});
+}
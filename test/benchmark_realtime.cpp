@@ -0,0 +1,81 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Benchmarks the jitter of round trips through `sp::realtime` to a device
+// that echoes everything, reporting percentiles of the latency.
+// The port is a pseudo terminal behind a mocked port.
+
+#include <libserialport.hpp>
+#include <spp/realtime.hpp>
+
+#include "libserialport_mock.hpp"
+#include "pty.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+namespace {
+  constexpr auto number_of_round_trips = 10'000U;
+
+  void echo(const std::stop_token &stop, const int fd) {
+    auto buf = std::array<char, 64>{};
+    while (!stop.stop_requested()) {
+      if (sp_test::wait_readable(fd, 10)) {
+        const auto ret = ::read(fd, buf.data(), buf.size());
+        if (ret > 0) {
+          (void)::write(fd, buf.data(), static_cast<std::size_t>(ret));
+        }
+      }
+    }
+  }
+
+  std::chrono::nanoseconds
+  percentile(const std::vector<std::chrono::nanoseconds> &sorted,
+             const double p) {
+    const auto index = static_cast<std::size_t>(
+        p * static_cast<double>(sorted.size() - 1U) + 0.5);
+    return sorted[index];
+  }
+} // namespace
+
+TEST_CASE("jitter of real-time round trips") {
+  auto pty = sp_test::pty{};
+  const auto port = sp::get_port_by_name("");
+  sp_mock::set_native_handle(port, pty.port());
+  auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+  auto device = std::jthread{echo, pty.device()};
+
+  // either may be refused without the privileges to do so
+  auto rt = sp::realtime{conn, {.lock_memory = true, .priority = 50}};
+  const auto &status = rt.get_realtime_status();
+  std::cout << "memory locked: " << (status.memory_locked == sp::status_t::OK)
+            << ", SCHED_FIFO: " << (status.scheduling == sp::status_t::OK)
+            << "\n";
+
+  auto latencies = std::vector<std::chrono::nanoseconds>{};
+  latencies.reserve(number_of_round_trips);
+  rt.tx_buffer()[0] = std::byte{'x'};
+  for (auto i = 0U; i < number_of_round_trips; ++i) {
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(rt.write(1U, 1'000) == 1);
+    REQUIRE(rt.read(1'000).size() == 1U);
+    latencies.push_back(std::chrono::steady_clock::now() - start);
+  }
+
+  std::ranges::sort(latencies);
+  const auto us = [](const std::chrono::nanoseconds ns) {
+    return std::chrono::duration<double, std::micro>{ns}.count();
+  };
+  std::cout << "round trips: " << latencies.size()
+            << ", p50: " << us(percentile(latencies, 0.5))
+            << " us, p99: " << us(percentile(latencies, 0.99))
+            << " us, p99.9: " << us(percentile(latencies, 0.999))
+            << " us, max: " << us(latencies.back()) << " us\n";
+  CHECK(latencies.front() <= latencies.back());
+}
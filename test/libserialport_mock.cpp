@@ -10,6 +10,19 @@ extern "C" {
 
 #include "libserialport_mock.hpp"
 
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <thread>
 #include <vector>
 
 namespace {
@@ -18,6 +31,63 @@ namespace {
   auto allocated_configs_ = std::vector<sp_port_config *>{};
   auto allocated_messages_ = std::vector<char *>{};
   auto next_status_ = sp_return{SP_OK};
+  auto detail_lookups_ = 0L;
+  auto open_delay_ = std::chrono::microseconds{0};
+  // ports may be opened and configured from several threads at once
+  auto mutex_ = std::mutex{};
+  // the configurations that have been set on ports
+  auto port_configs_ = std::map<const sp_port *, sp_port_config>{};
+  // where ports receive from, if not from their native handle
+  auto receive_handles_ = std::map<const sp_port *, int>{};
+
+  bool has_handle(const sp_port *const port) {
+    return port != nullptr && port->fd >= 0;
+  }
+
+  int receive_handle(const sp_port *const port) {
+    const auto lock = std::scoped_lock{mutex_};
+    const auto it = receive_handles_.find(port);
+    return it != receive_handles_.end() ? it->second : port->fd;
+  }
+
+  // emulates libserialport's I/O on ports that have a native handle
+  sp_return transfer(sp_port *const port, void *const buf, const size_t count,
+                     const unsigned timeout_ms, const bool is_write,
+                     const bool return_early) {
+    const auto deadline = std::chrono::steady_clock::now()
+                          + std::chrono::milliseconds{timeout_ms};
+    const auto fd = is_write ? port->fd : receive_handle(port);
+    auto done = size_t{0};
+    while (done < count) {
+      const auto ret = is_write ? write(fd,
+                                        static_cast<const char *>(buf) + done,
+                                        count - done)
+                                : read(fd, static_cast<char *>(buf) + done,
+                                       count - done);
+      if (ret > 0) {
+        done += static_cast<size_t>(ret);
+        if (return_early) {
+          break;
+        }
+        continue;
+      }
+      if (ret < 0 && errno != EAGAIN && errno != EINTR) {
+        return SP_ERR_FAIL;
+      }
+      auto remaining = -1L;
+      if (timeout_ms > 0) {
+        remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now())
+                        .count();
+        if (remaining <= 0) {
+          break;
+        }
+      }
+      auto pfd = pollfd{fd, is_write ? short{POLLOUT} : short{POLLIN}, 0};
+      poll(&pfd, 1, static_cast<int>(remaining));
+    }
+    return static_cast<sp_return>(done);
+  }
 } // namespace
 
 long sp_mock::number_of_allocated_lists() {
@@ -36,10 +106,25 @@ long sp_mock::number_of_allocated_messages() {
   return ssize(allocated_messages_);
 }
 
+long sp_mock::number_of_detail_lookups() { return detail_lookups_; }
+
+void sp_mock::set_open_delay(const std::chrono::microseconds delay) {
+  open_delay_ = delay;
+}
+
 void sp_mock::set_next_status(const sp::status_t status) {
   next_status_ = static_cast<sp_return>(status);
 }
 
+void sp_mock::set_native_handle(const sp::port_t &p, const int fd) {
+  p->fd = fd;
+}
+
+void sp_mock::set_receive_handle(const sp::port_t &p, const int fd) {
+  const auto lock = std::scoped_lock{mutex_};
+  receive_handles_[p.get()] = fd;
+}
+
 sp_return sp_list_ports(sp_port ***list_ptr) {
   *list_ptr = new sp_port *[3];
   sp_get_port_by_name("", *list_ptr);
@@ -55,42 +140,93 @@ void sp_free_port_list(sp_port **ports) {
 }
 
 sp_return sp_get_port_by_name(const char *const portname, sp_port **port_ptr) {
+  const auto lock = std::scoped_lock{mutex_};
   (void)portname;
-  *port_ptr = new sp_port;
+  // allocated like libserialport does, so that ports can be created elsewhere
+  *port_ptr = static_cast<sp_port *>(calloc(1U, sizeof(sp_port)));
+  (*port_ptr)->usb_bus = -1;
+  (*port_ptr)->usb_address = -1;
+  (*port_ptr)->usb_vid = -1;
+  (*port_ptr)->usb_pid = -1;
+  (*port_ptr)->fd = -1;
   allocated_ports_.push_back(*port_ptr);
   return next_status_;
 }
 
 void sp_free_port(sp_port *port) {
+  const auto lock = std::scoped_lock{mutex_};
   std::erase(allocated_ports_, port);
-  delete port;
+  port_configs_.erase(port);
+  receive_handles_.erase(port);
+  free(port->name);
+  free(port->description);
+  free(port->usb_manufacturer);
+  free(port->usb_product);
+  free(port->usb_serial);
+  free(port->bluetooth_address);
+  free(port);
+}
+
+// fills in made up details, according to the transport
+sp_return get_port_details(sp_port *port) {
+  const auto lock = std::scoped_lock{mutex_};
+  ++detail_lookups_;
+  port->description = strdup("mock port");
+  if (port->transport == SP_TRANSPORT_USB) {
+    port->usb_bus = 1;
+    port->usb_address = 2;
+    port->usb_vid = 0x0403;
+    port->usb_pid = 0x6001;
+    port->usb_manufacturer = strdup("FTDI");
+    port->usb_product = strdup("FT232R USB UART");
+    port->usb_serial = strdup("A50285BI");
+  } else if (port->transport == SP_TRANSPORT_BLUETOOTH) {
+    port->bluetooth_address = strdup("00:11:22:33:44:55");
+  }
+  return next_status_;
 }
 
 sp_return sp_new_config(sp_port_config **config_ptr) {
+  const auto lock = std::scoped_lock{mutex_};
   *config_ptr = new sp_port_config;
+  (*config_ptr)->baudrate = -1;
+  (*config_ptr)->bits = -1;
+  (*config_ptr)->parity = SP_PARITY_INVALID;
+  (*config_ptr)->stopbits = -1;
   allocated_configs_.push_back(*config_ptr);
   return next_status_;
 }
 
 void sp_free_config(sp_port_config *const cfg) {
+  const auto lock = std::scoped_lock{mutex_};
   std::erase(allocated_configs_, cfg);
   delete cfg;
 }
 
 char *sp_last_error_message() {
+  const auto lock = std::scoped_lock{mutex_};
   char *msg = new char;
   allocated_messages_.push_back(msg);
   return msg;
 }
 
 void sp_free_error_message(char *message) {
+  const auto lock = std::scoped_lock{mutex_};
   std::erase(allocated_messages_, message);
   delete message;
 }
 
 sp_return sp_open(sp_port *port, sp_mode flags) {
-  (void)port;
   (void)flags;
+  // libserialport sets the port up as it opens it, which fails on anything
+  // but a terminal and takes a while on some adapters
+  if (has_handle(port)) {
+    auto t = termios{};
+    if (tcgetattr(port->fd, &t) < 0 || tcsetattr(port->fd, TCSANOW, &t) < 0) {
+      return SP_ERR_FAIL;
+    }
+    std::this_thread::sleep_for(open_delay_);
+  }
   return next_status_;
 }
 
@@ -100,71 +236,92 @@ sp_return sp_close(sp_port *port) {
 }
 
 char *sp_get_port_name(const sp_port *p) {
-  (void)p;
-  return NULL;
+  return p != nullptr ? p->name : NULL;
 }
 
 char *sp_get_port_description(const sp_port *p) {
-  (void)p;
-  return NULL;
+  return p != nullptr ? p->description : NULL;
 }
 
 sp_transport sp_get_port_transport(const sp_port *p) {
-  (void)p;
-  return SP_TRANSPORT_NATIVE;
+  return p != nullptr ? p->transport : SP_TRANSPORT_NATIVE;
 }
 
 sp_return sp_get_port_usb_bus_address(const sp_port *port, int *usb_bus,
                                       int *usb_address) {
-  (void)port;
-  (void)usb_bus;
-  (void)usb_address;
+  if (port != nullptr && port->transport == SP_TRANSPORT_USB) {
+    *usb_bus = port->usb_bus;
+    *usb_address = port->usb_address;
+  }
   return next_status_;
 }
 
 sp_return sp_get_port_usb_vid_pid(const sp_port *port, int *usb_vid,
                                   int *usb_pid) {
-  (void)port;
-  (void)usb_vid;
-  (void)usb_pid;
+  if (port != nullptr && port->transport == SP_TRANSPORT_USB) {
+    *usb_vid = port->usb_vid;
+    *usb_pid = port->usb_pid;
+  }
   return next_status_;
 }
 
 char *sp_get_port_usb_manufacturer(const sp_port *port) {
-  (void)port;
-  return NULL;
+  return port != nullptr ? port->usb_manufacturer : NULL;
 }
 
 char *sp_get_port_usb_product(const sp_port *port) {
-  (void)port;
-  return NULL;
+  return port != nullptr ? port->usb_product : NULL;
 }
 
 char *sp_get_port_usb_serial(const sp_port *port) {
-  (void)port;
-  return NULL;
+  return port != nullptr ? port->usb_serial : NULL;
 }
 
 char *sp_get_port_bluetooth_address(const sp_port *port) {
-  (void)port;
-  return NULL;
+  return port != nullptr ? port->bluetooth_address : NULL;
 }
 
 sp_return sp_get_port_handle(const sp_port *port, void *result_ptr) {
-  (void)port;
-  (void)result_ptr;
+  if (port != nullptr) {
+    *static_cast<int *>(result_ptr) = port->fd;
+  }
   return next_status_;
 }
 
 sp_return sp_get_config(sp_port *port, sp_port_config *config) {
-  (void)port;
-  (void)config;
+  const auto lock = std::scoped_lock{mutex_};
+  if (const auto it = port_configs_.find(port); it != port_configs_.end()) {
+    *config = it->second;
+  }
   return next_status_;
 }
 
+// settings that are left alone keep what has been set before
 sp_return sp_set_config(sp_port *port, const sp_port_config *config) {
-  (void)port;
-  (void)config;
+  const auto lock = std::scoped_lock{mutex_};
+  if (next_status_ == SP_OK) {
+    const auto [it, inserted] = port_configs_.try_emplace(port, *config);
+    auto &stored = it->second;
+    if (!inserted) {
+      stored.baudrate = config->baudrate != -1 ? config->baudrate
+                                               : stored.baudrate;
+      stored.bits = config->bits != -1 ? config->bits : stored.bits;
+      stored.parity = config->parity != SP_PARITY_INVALID ? config->parity
+                                                          : stored.parity;
+      stored.stopbits = config->stopbits != -1 ? config->stopbits
+                                               : stored.stopbits;
+    }
+    // like libserialport, which ignores parity errors without a parity
+    auto t = termios{};
+    if (config->parity != SP_PARITY_INVALID && has_handle(port)
+        && tcgetattr(port->fd, &t) == 0) {
+      t.c_iflag &= ~static_cast<tcflag_t>(IGNPAR);
+      if (config->parity == SP_PARITY_NONE) {
+        t.c_iflag |= IGNPAR;
+      }
+      tcsetattr(port->fd, TCSANOW, &t);
+    }
+  }
   return next_status_;
 }
 
@@ -176,103 +333,142 @@ sp_return sp_set_baudrate(sp_port *port, int baudrate) {
 
 sp_return sp_get_config_baudrate(const sp_port_config *config,
                                  int *baudrate_ptr) {
-  (void)config;
-  (void)baudrate_ptr;
+  *baudrate_ptr = config->baudrate;
   return next_status_;
 }
 
 sp_return sp_set_config_baudrate(sp_port_config *config, int baudrate) {
-  (void)config;
-  (void)baudrate;
+  config->baudrate = baudrate;
   return next_status_;
 }
 
 sp_return sp_get_config_bits(const sp_port_config *config, int *bits_ptr) {
-  (void)config;
-  (void)bits_ptr;
+  *bits_ptr = config->bits;
   return next_status_;
 }
 
 sp_return sp_set_config_bits(sp_port_config *config, int bits) {
-  (void)config;
-  (void)bits;
+  config->bits = bits;
   return next_status_;
 }
 
 sp_return sp_get_config_parity(const sp_port_config *config,
                                sp_parity *parity_ptr) {
-  (void)config;
-  (void)parity_ptr;
+  *parity_ptr = config->parity;
   return next_status_;
 }
 
 sp_return sp_set_config_parity(sp_port_config *config, sp_parity parity) {
-  (void)config;
-  (void)parity;
+  config->parity = parity;
   return next_status_;
 }
 
 sp_return sp_get_config_stopbits(const sp_port_config *config,
                                  int *stopbits_ptr) {
-  (void)config;
-  (void)stopbits_ptr;
+  *stopbits_ptr = config->stopbits;
   return next_status_;
 }
 
 sp_return sp_set_config_stopbits(sp_port_config *config, int stopbits) {
-  (void)config;
-  (void)stopbits;
+  config->stopbits = stopbits;
   return next_status_;
 }
 
 sp_return sp_blocking_read(sp_port *port, void *buf, size_t count,
                            unsigned int timeout_ms) {
-  (void)port;
-  (void)buf;
-  (void)count;
-  (void)timeout_ms;
+  if (has_handle(port)) {
+    return transfer(port, buf, count, timeout_ms, false, false);
+  }
   return next_status_;
 }
 
 sp_return sp_blocking_read_next(sp_port *port, void *buf, size_t count,
                                 unsigned int timeout_ms) {
-  (void)port;
-  (void)buf;
-  (void)count;
-  (void)timeout_ms;
+  if (has_handle(port)) {
+    return transfer(port, buf, count, timeout_ms, false, true);
+  }
   return next_status_;
 }
 
 sp_return sp_nonblocking_read(sp_port *port, void *buf, size_t count) {
-  (void)port;
-  (void)buf;
-  (void)count;
+  if (has_handle(port)) {
+    const auto ret = read(receive_handle(port), buf, count);
+    if (ret < 0) {
+      return errno == EAGAIN ? SP_OK : SP_ERR_FAIL;
+    }
+    return static_cast<sp_return>(ret);
+  }
   return next_status_;
 }
 
 sp_return sp_blocking_write(sp_port *port, const void *buf, size_t count,
                             unsigned int timeout_ms) {
-  (void)port;
-  (void)buf;
-  (void)count;
-  (void)timeout_ms;
+  if (has_handle(port)) {
+    return transfer(port, const_cast<void *>(buf), count, timeout_ms, true,
+                    false);
+  }
   return next_status_;
 }
 
 sp_return sp_nonblocking_write(sp_port *port, const void *buf, size_t count) {
-  (void)port;
-  (void)buf;
-  (void)count;
+  if (has_handle(port)) {
+    const auto ret = write(port->fd, buf, count);
+    if (ret < 0) {
+      return errno == EAGAIN ? SP_OK : SP_ERR_FAIL;
+    }
+    return static_cast<sp_return>(ret);
+  }
   return next_status_;
 }
 
 sp_return sp_input_waiting(sp_port *port) {
-  (void)port;
+  if (has_handle(port)) {
+    auto bytes = 0;
+    return ioctl(receive_handle(port), FIONREAD, &bytes) < 0
+               ? SP_ERR_FAIL
+               : static_cast<sp_return>(bytes);
+  }
   return next_status_;
 }
 
 sp_return sp_output_waiting(sp_port *port) {
+  if (has_handle(port)) {
+    auto bytes = 0;
+    return ioctl(port->fd, TIOCOUTQ, &bytes) < 0 ? SP_ERR_FAIL
+                                                 : static_cast<sp_return>(bytes);
+  }
+  return next_status_;
+}
+
+sp_return sp_start_break(sp_port *port) {
+  if (has_handle(port)) {
+    return ioctl(port->fd, TIOCSBRK) < 0 ? SP_ERR_FAIL : SP_OK;
+  }
+  return next_status_;
+}
+
+sp_return sp_end_break(sp_port *port) {
+  if (has_handle(port)) {
+    return ioctl(port->fd, TIOCCBRK) < 0 ? SP_ERR_FAIL : SP_OK;
+  }
+  return next_status_;
+}
+
+sp_return sp_set_dtr(sp_port *port, sp_dtr dtr) {
+  (void)port;
+  (void)dtr;
+  return next_status_;
+}
+
+sp_return sp_set_rts(sp_port *port, sp_rts rts) {
+  (void)port;
+  (void)rts;
+  return next_status_;
+}
+
+sp_return sp_set_flowcontrol(sp_port *port, sp_flowcontrol flowcontrol) {
   (void)port;
+  (void)flowcontrol;
   return next_status_;
 }
 
@@ -286,3 +482,58 @@ sp_return sp_drain(sp_port *port) {
   (void)port;
   return next_status_;
 }
+
+sp_return sp_new_event_set(sp_event_set **result_ptr) {
+  *result_ptr = new sp_event_set{nullptr, nullptr, 0};
+  return next_status_;
+}
+
+sp_return sp_add_port_events(sp_event_set *event_set, const sp_port *port,
+                             sp_event mask) {
+  auto *const handles = new int[event_set->count + 1];
+  auto *const masks = new sp_event[event_set->count + 1];
+  std::copy_n(static_cast<int *>(event_set->handles), event_set->count,
+              handles);
+  std::copy_n(event_set->masks, event_set->count, masks);
+  handles[event_set->count] = port->fd;
+  masks[event_set->count] = mask;
+  delete[] static_cast<int *>(event_set->handles);
+  delete[] event_set->masks;
+  event_set->handles = handles;
+  event_set->masks = masks;
+  ++event_set->count;
+  return next_status_;
+}
+
+sp_return sp_wait(sp_event_set *event_set, unsigned int timeout_ms) {
+  // does not allocate, so as not to count against allocation tests
+  auto fds = std::array<pollfd, 64>{};
+  if (event_set->count > fds.size()) {
+    // ports beyond these would never be waited for
+    std::fprintf(stderr, "sp_wait: the mock waits for at most %zu ports\n",
+                 fds.size());
+    std::abort();
+  }
+  auto nfds = nfds_t{0};
+  for (auto i = 0U; i < event_set->count; ++i) {
+    const auto fd = static_cast<int *>(event_set->handles)[i];
+    if (fd >= 0) {
+      const auto mask = static_cast<unsigned>(event_set->masks[i]);
+      fds[nfds++] = {fd,
+                     static_cast<short>(
+                         ((mask & SP_EVENT_RX_READY) != 0U ? POLLIN : 0)
+                         | ((mask & SP_EVENT_TX_READY) != 0U ? POLLOUT : 0)),
+                     0};
+    }
+  }
+  if (nfds > 0U) {
+    poll(fds.data(), nfds, timeout_ms > 0 ? static_cast<int>(timeout_ms) : -1);
+  }
+  return next_status_;
+}
+
+void sp_free_event_set(sp_event_set *event_set) {
+  delete[] static_cast<int *>(event_set->handles);
+  delete[] event_set->masks;
+  delete event_set;
+}
@@ -7,6 +7,8 @@
 
 #include <libserialport.hpp>
 
+#include <chrono>
+
 namespace sp_mock {
 
   long number_of_allocated_lists();
@@ -14,8 +16,23 @@ namespace sp_mock {
   long number_of_allocated_configs();
   long number_of_allocated_messages();
 
+  // counts how often the details of ports have been looked up
+  long number_of_detail_lookups();
+
   void set_next_status(sp::status_t status);
 
+  // makes opening a port that has a native handle take the given time
+  void set_open_delay(std::chrono::microseconds delay);
+
+  // lets the I/O functions of the port operate on the given native handle,
+  // e.g. a pseudo terminal, which the actual libserialport refuses to open
+  void set_native_handle(const sp::port_t &p, int fd);
+
+  // lets the reads of the port take from the given file descriptor instead of
+  // the native handle, e.g. a pipe, which passes error marks on as they are
+  // written, unlike the line discipline of a pseudo terminal
+  void set_receive_handle(const sp::port_t &p, int fd);
+
 } // namespace sp_mock
 
 #endif // LIBSERIALPORT_MOCK_HPP_INCLUDED
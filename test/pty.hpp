@@ -0,0 +1,190 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Provides pseudo terminals as stand-ins for serial ports.
+
+#ifndef PTY_HPP_INCLUDED
+#define PTY_HPP_INCLUDED
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <array>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <stop_token>
+#include <string>
+#include <thread>
+#include <utility>
+
+namespace sp_test {
+
+  // a pair of pseudo terminal ends in raw mode
+  // the `port` end is meant to be handed to a mocked port, while the `device`
+  // end plays the device attached to it
+  class pty {
+   public:
+    pty() {
+      port_ = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+      if (port_ < 0 || grantpt(port_) != 0 || unlockpt(port_) != 0) {
+        std::abort();
+      }
+      device_ = open(ptsname(port_), O_RDWR | O_NOCTTY | O_NONBLOCK);
+      if (device_ < 0) {
+        std::abort();
+      }
+      make_raw(port_);
+      make_raw(device_);
+    }
+
+    ~pty() {
+      close_device();
+      if (port_ >= 0) {
+        close(port_);
+      }
+    }
+
+    pty(const pty &) = delete;
+    pty &operator=(const pty &) = delete;
+
+    pty(pty &&other) noexcept
+        : port_{std::exchange(other.port_, -1)},
+          device_{std::exchange(other.device_, -1)} {}
+    pty &operator=(pty &&) = delete;
+
+    int port() const noexcept {
+      return port_;
+    }
+
+    int device() const noexcept {
+      return device_;
+    }
+
+    // simulates unplugging the device
+    void close_device() {
+      if (device_ >= 0) {
+        close(device_);
+        device_ = -1;
+      }
+    }
+
+    // hangs up the terminal, as when an adapter is unplugged
+    void close_port() {
+      if (port_ >= 0) {
+        close(port_);
+        port_ = -1;
+      }
+    }
+
+   private:
+    static void make_raw(const int fd) {
+      auto t = termios{};
+      tcgetattr(fd, &t);
+      cfmakeraw(&t);
+      tcsetattr(fd, TCSANOW, &t);
+    }
+
+    int port_{-1};
+    int device_{-1};
+  };
+
+  // a nonblocking pipe, whose ends are closed when it goes out of scope
+  class pipe {
+   public:
+    pipe() {
+      if (pipe2(fds_.data(), O_NONBLOCK) != 0) {
+        std::abort();
+      }
+    }
+
+    ~pipe() {
+      for (const auto fd : fds_) {
+        close(fd);
+      }
+    }
+
+    pipe(const pipe &) = delete;
+    pipe &operator=(const pipe &) = delete;
+
+    pipe(pipe &&) = delete;
+    pipe &operator=(pipe &&) = delete;
+
+    int read_end() const noexcept {
+      return fds_[0];
+    }
+
+    int write_end() const noexcept {
+      return fds_[1];
+    }
+
+   private:
+    std::array<int, 2> fds_{-1, -1};
+  };
+
+  // relays data between two file descriptors, e.g. the `device` ends of two
+  // ptys, passing it through a filter in either direction on the way
+  // filters may change, drop or hold back what they are given
+  class link {
+   public:
+    using filter_t = std::function<void(std::string &)>;
+
+    link(const int a, const int b, filter_t a_to_b, filter_t b_to_a)
+        : thread_{[a, b, a_to_b = std::move(a_to_b),
+                   b_to_a = std::move(b_to_a)](
+                      const std::stop_token &stop) mutable {
+            auto pfds = std::array{pollfd{a, POLLIN, 0}, pollfd{b, POLLIN, 0}};
+            while (!stop.stop_requested()) {
+              if (poll(pfds.data(), pfds.size(), 10) <= 0) {
+                continue;
+              }
+              if ((pfds[0].revents & POLLIN) != 0) {
+                relay(a, b, a_to_b, stop);
+              }
+              if ((pfds[1].revents & POLLIN) != 0) {
+                relay(b, a, b_to_a, stop);
+              }
+            }
+          }} {}
+
+   private:
+    static void relay(const int from, const int to, filter_t &filter,
+                      const std::stop_token &stop) {
+      auto buf = std::array<char, 4'096>{};
+      const auto ret = read(from, buf.data(), buf.size());
+      if (ret <= 0) {
+        return;
+      }
+      auto chunk = std::string(buf.data(), static_cast<std::size_t>(ret));
+      if (filter) {
+        filter(chunk);
+      }
+      for (auto done = std::size_t{0};
+           done < chunk.size() && !stop.stop_requested();) {
+        const auto written =
+            write(to, chunk.data() + done, chunk.size() - done);
+        if (written >= 0) {
+          done += static_cast<std::size_t>(written);
+        } else if (errno == EAGAIN) {
+          auto pfd = pollfd{to, POLLOUT, 0};
+          poll(&pfd, 1, 10);
+        } else {
+          return;
+        }
+      }
+    }
+
+    std::jthread thread_;
+  };
+
+  // data written to one end of a pty arrives at the other asynchronously
+  inline bool wait_readable(const int fd, const int timeout_ms = 1'000) {
+    auto pfd = pollfd{fd, POLLIN, 0};
+    return poll(&pfd, 1, timeout_ms) == 1;
+  }
+
+} // namespace sp_test
+
+#endif // PTY_HPP_INCLUDED
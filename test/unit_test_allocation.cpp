@@ -0,0 +1,229 @@
+// Darius Kellermann <kellermann@pm.me>, October 2026
+
+// Unit tests the C++ interface by mocking the libserialport API.
+// These scenarios focus on allocations, which must not happen on the heap
+// once buffers have been set up from a memory resource.
+
+#include <libserialport.hpp>
+#include <spp/realtime.hpp>
+#include <spp/transactor.hpp>
+#include <spp/write_queue.hpp>
+
+#include "libserialport_mock.hpp"
+#include "pty.hpp"
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <memory_resource>
+#include <new>
+#include <thread>
+
+namespace {
+  auto heap_allocations_ = std::atomic<std::size_t>{0};
+
+  // plays a device that responds to every line with `ok`, or else discards
+  // what it receives
+  void play_device(const std::stop_token &stop, const int fd,
+                   const bool respond) {
+    auto buf = std::array<char, 256>{};
+    while (!stop.stop_requested()) {
+      if (!sp_test::wait_readable(fd, 10)) {
+        continue;
+      }
+      const auto ret = ::read(fd, buf.data(), buf.size());
+      if (!respond || ret <= 0) {
+        continue;
+      }
+      const auto lines = std::count(buf.begin(), buf.begin() + ret, '\n');
+      for (auto i = 0; i < lines; ++i) {
+        (void)::write(fd, "ok\n", 3);
+      }
+    }
+  }
+
+  class counting_resource : public std::pmr::memory_resource {
+   public:
+    std::size_t allocations() const noexcept {
+      return allocations_;
+    }
+
+    std::size_t outstanding() const noexcept {
+      return outstanding_;
+    }
+
+   private:
+    void *do_allocate(const std::size_t bytes,
+                      const std::size_t alignment) override {
+      ++allocations_;
+      ++outstanding_;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+
+    void do_deallocate(void *const p, const std::size_t bytes,
+                       const std::size_t alignment) override {
+      --outstanding_;
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+
+    bool do_is_equal(
+        const std::pmr::memory_resource &other) const noexcept override {
+      return this == &other;
+    }
+
+    std::size_t allocations_{0};
+    std::size_t outstanding_{0};
+  };
+} // namespace
+
+void *operator new(const std::size_t size) {
+  ++heap_allocations_;
+  if (auto *const p = std::malloc(size > 0U ? size : 1U)) {
+    return p;
+  }
+  throw std::bad_alloc{};
+}
+
+void operator delete(void *const p) noexcept { std::free(p); }
+
+void operator delete(void *const p, std::size_t) noexcept { std::free(p); }
+
+SCENARIO("transactions do not allocate from the heap") {
+  GIVEN("a transactor with an arena, talking to a device") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    // running out of the arena throws, rather than falling back to the heap
+    static auto arena = std::array<std::byte, 64U * 1024U>{};
+    auto monotonic = std::pmr::monotonic_buffer_resource{
+        arena.data(), arena.size(), std::pmr::null_memory_resource()};
+    auto pool = std::pmr::unsynchronized_pool_resource{&monotonic};
+    auto transactor = sp::pmr::transactor{
+        conn, sp::pmr::terminated_by(std::byte{'\n'}), 1U, &pool};
+    auto device = std::jthread{play_device, pty.device(), true};
+
+    const auto request = std::array<std::byte, 2>{std::byte{'?'},
+                                                  std::byte{'\n'}};
+    // the first transaction sets up the buffers
+    REQUIRE(transactor.transact(request, 1'000).data.size() == 3U);
+
+    WHEN("many transactions are carried out") {
+      const auto before = heap_allocations_.load();
+      auto completed = 0;
+      for (auto i = 0; i < 100; ++i) {
+        const auto response = transactor.transact(request, 1'000);
+        completed += !response.timed_out && response.data.size() == 3U ? 1 : 0;
+      }
+      const auto allocations = heap_allocations_.load() - before;
+
+      THEN("none of them allocates from the heap") {
+        CHECK(completed == 100);
+        CHECK(allocations == 0U);
+      }
+    }
+  }
+}
+
+SCENARIO("queued writes do not allocate from the heap") {
+  GIVEN("a write queue with an arena, on a port whose device reads") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    static auto arena = std::array<std::byte, 64U * 1024U>{};
+    auto monotonic = std::pmr::monotonic_buffer_resource{
+        arena.data(), arena.size(), std::pmr::null_memory_resource()};
+    // futures may be released by either the producer or the drainer
+    auto pool = std::pmr::synchronized_pool_resource{&monotonic};
+    auto device = std::jthread{play_device, pty.device(), false};
+    auto queue = sp::write_queue{conn, {.capacity = 1'024U}, &pool};
+
+    // the first write starts up the drainer
+    const auto data = std::array<std::byte, 16>{};
+    REQUIRE(queue.write_async(data).get() == 16);
+    REQUIRE(queue.drain(1'000));
+
+    WHEN("many writes are queued") {
+      const auto before = heap_allocations_.load();
+      auto queued = 0;
+      for (auto i = 0; i < 100; ++i) {
+        queued += queue.write_blocking(data, 1'000);
+        queued += queue.write_async(data).get();
+      }
+      const auto drained = queue.drain(1'000);
+      const auto allocations = heap_allocations_.load() - before;
+
+      THEN("none of them allocates from the heap") {
+        CHECK(queued == 3'200);
+        CHECK(drained);
+        CHECK(allocations == 0U);
+      }
+    }
+  }
+}
+
+SCENARIO("real-time I/O does not allocate from the heap") {
+  GIVEN("a real-time setup of a port, talking to a device") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+    auto rt = sp::realtime{conn, {.lock_memory = false, .low_latency = false}};
+    auto device = std::jthread{play_device, pty.device(), true};
+
+    WHEN("many exchanges are carried out") {
+      const auto before = heap_allocations_.load();
+      auto completed = 0;
+      for (auto i = 0; i < 100; ++i) {
+        std::memcpy(rt.tx_buffer().data(), "?\n", 2);
+        auto received = std::size_t{0};
+        if (rt.write(2U, 1'000) == 2) {
+          while (received < 3U) {
+            const auto data = rt.read(1'000);
+            if (data.empty()) {
+              break;
+            }
+            received += data.size();
+          }
+        }
+        completed += received == 3U ? 1 : 0;
+      }
+      const auto allocations = heap_allocations_.load() - before;
+
+      THEN("none of them allocates from the heap") {
+        CHECK(completed == 100);
+        CHECK(allocations == 0U);
+      }
+    }
+  }
+}
+
+SCENARIO("port lists are allocated from a memory resource") {
+  GIVEN("a memory resource") {
+    auto resource = counting_resource{};
+
+    WHEN("ports are listed") {
+      auto ports = sp::list_ports(&resource);
+
+      THEN("the list and the bookkeeping of the ports are allocated from it") {
+        REQUIRE(ports.size() == 2U);
+        CHECK(resource.allocations() == 3U);
+      }
+      AND_WHEN("the list is cleared") {
+        ports.clear();
+        ports.shrink_to_fit();
+        THEN("all of it is returned") {
+          CHECK(resource.outstanding() == 0U);
+        }
+      }
+    }
+  }
+}
@@ -4,7 +4,1929 @@
 // These scenarios focus on the API logic.
 
 #include <libserialport.hpp>
+#include <spp/autodetect.hpp>
+#include <spp/batch_io.hpp>
+#include <spp/bridge.hpp>
+#include <spp/bulk_open.hpp>
+#include <spp/bulk_transfer.hpp>
+#include <spp/fanout.hpp>
+#include <spp/port_manager.hpp>
+#include <spp/realtime.hpp>
+#include <spp/rfc2217_server.hpp>
+#include <spp/sharded_runtime.hpp>
+#include <spp/transactor.hpp>
+#include <spp/write_queue.hpp>
+
+#include "libserialport_mock.hpp"
+#include "pty.hpp"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sched.h>
+#include <sys/socket.h>
 
 #include <catch2/catch_test_macros.hpp>
+#include <catch2/generators/catch_generators.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <future>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+using namespace std::chrono_literals;
+using namespace std::string_view_literals;
+
+SCENARIO("static configurations are resolved at compile time") {
+  GIVEN("a fully specified configuration") {
+    using cfg_t = sp::static_config<115200, 8, sp::parity_t::None, 1>;
+    THEN("all settings are applied") {
+      STATIC_REQUIRE(cfg_t::value.baud_rate == 115200);
+      STATIC_REQUIRE(cfg_t::value.bits == 8);
+      STATIC_REQUIRE(cfg_t::value.stop_bits == 1);
+      STATIC_REQUIRE(cfg_t::value.parity == sp::parity_t::None);
+      STATIC_REQUIRE(cfg_t::fields == sp::config_field_t::All);
+    }
+  }
+
+  GIVEN("a configuration that leaves settings alone") {
+    using cfg_t = sp::static_config<-1, 7, sp::parity_t::Invalid, -1>;
+    THEN("only the remaining settings are applied") {
+      STATIC_REQUIRE(cfg_t::fields == sp::config_field_t::Bits);
+      STATIC_REQUIRE(sp::fields_of(cfg_t{}) == cfg_t::fields);
+    }
+    AND_WHEN("it is applied to a connection") {
+      auto conn = sp::connection{{}, sp::mode_t::ReadWrite, cfg_t{}};
+      THEN("the configuration is set") {
+        CHECK(conn.set_config(cfg_t{}) == sp::status_t::OK);
+      }
+    }
+  }
+
+  GIVEN("a configuration that leaves all settings alone") {
+    auto conn = sp::connection{{}, sp::mode_t::ReadWrite};
+    WHEN("it is applied after a call that failed") {
+      auto buf = std::array<char, 1>{};
+      REQUIRE(conn.read_blocking(buf.data(), 0, 0) == -1);
+      REQUIRE(sp::get_status() == sp::status_t::InvalidArgument);
+      THEN("the status is reset") {
+        CHECK(conn.set_config({}) == sp::status_t::OK);
+        CHECK(sp::get_status() == sp::status_t::OK);
+      }
+    }
+  }
+}
+
+SCENARIO("reads are sized after the data that is waiting") {
+  GIVEN("common port configurations") {
+    THEN("the time per character follows from baud rate and framing") {
+      STATIC_REQUIRE(sp::character_time_us(
+                         sp::static_config<9600, 8, sp::parity_t::None, 1>{})
+                     == 1'042);
+      STATIC_REQUIRE(sp::character_time_us(
+                         sp::static_config<115200, 8, sp::parity_t::Even, 2>{})
+                     == 105);
+      STATIC_REQUIRE(sp::character_time_us({}) == -1);
+    }
+  }
+
+  GIVEN("a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    WHEN("several bytes are waiting") {
+      REQUIRE(::write(pty.device(), "hello", 5) == 5);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      REQUIRE(conn.input_waiting() == 5);
+      THEN("they are read at once") {
+        auto buf = std::array<char, 64>{};
+        CHECK(conn.read_adaptive(buf.data(), buf.size(), 100, 0) == 5);
+        CHECK(std::memcmp(buf.data(), "hello", 5) == 0);
+      }
+    }
+
+    WHEN("no bytes are waiting") {
+      THEN("the read times out") {
+        auto buf = std::array<char, 64>{};
+        CHECK(conn.read_adaptive(buf.data(), buf.size(), 10, 5) == 0);
+      }
+    }
+
+    // the rest of a burst arrives while the beginning is being read
+    const auto write_later = [&pty](const std::string_view data) {
+      return std::jthread{[&pty, data] {
+        std::this_thread::sleep_for(10ms);
+        [[maybe_unused]] const auto ret =
+            ::write(pty.device(), data.data(), data.size());
+      }};
+    };
+
+    WHEN("a burst arrives with a latency budget") {
+      // the line counts as idle after 4 characters, which take 33 ms at
+      // 1200 baud, longer than the rest of the burst takes to arrive
+      REQUIRE(conn.set_config({.baud_rate = 1'200,
+                               .bits = 8,
+                               .stop_bits = 1,
+                               .parity = sp::parity_t::None})
+              == sp::status_t::OK);
+      REQUIRE(::write(pty.device(), "hel", 3) == 3);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      const auto writer = write_later("lo world");
+      THEN("it is read in one go") {
+        auto buf = std::array<char, 64>{};
+        // 200 ms are worth 24 characters at 1200 baud, more than arrive
+        CHECK(conn.read_adaptive(buf.data(), buf.size(), 100, 200) == 11);
+        CHECK(std::memcmp(buf.data(), "hello world", 11) == 0);
+      }
+    }
+
+    WHEN("a short reply arrives with a long latency budget") {
+      REQUIRE(conn.set_config({.baud_rate = 9'600,
+                               .bits = 8,
+                               .stop_bits = 1,
+                               .parity = sp::parity_t::None})
+              == sp::status_t::OK);
+      REQUIRE(::write(pty.device(), "ok", 2) == 2);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      THEN("the read returns once the line goes quiet") {
+        auto buf = std::array<char, 64>{};
+        const auto start = std::chrono::steady_clock::now();
+        CHECK(conn.read_adaptive(buf.data(), buf.size(), 100, 1'000) == 2);
+        CHECK(std::chrono::steady_clock::now() - start < 500ms);
+      }
+    }
+
+    WHEN("the baud rate is changed by a static configuration") {
+      REQUIRE(conn.set_config({.baud_rate = 9'600,
+                               .bits = 8,
+                               .stop_bits = 1,
+                               .parity = sp::parity_t::None})
+              == sp::status_t::OK);
+      auto buf = std::array<char, 64>{};
+      REQUIRE(::write(pty.device(), "x", 1) == 1);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      REQUIRE(conn.read_adaptive(buf.data(), buf.size(), 100, 1) == 1);
+      REQUIRE(conn.set_config(sp::static_config<1'200, 8>{})
+              == sp::status_t::OK);
+
+      REQUIRE(::write(pty.device(), "a", 1) == 1);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      const auto writer = write_later(std::string_view{buf.data(), 40U});
+      THEN("the read is sized after the new baud rate") {
+        // 100 ms are worth 11 characters at 1200 baud, but 95 at 9600 baud
+        CHECK(conn.read_adaptive(buf.data(), buf.size(), 100, 100) == 12);
+      }
+    }
+  }
+}
+
+SCENARIO("the latency timer of FTDI adapters is tuned via sysfs") {
+  GIVEN("a sysfs tree with an FTDI adapter") {
+    const auto sysfs_root =
+        std::filesystem::temp_directory_path()
+        / ("libspp_sysfs_" + std::to_string(::getpid()));
+    const auto device = sysfs_root / "class/tty/ttyUSB0/device";
+    std::filesystem::create_directories(device);
+    std::ofstream{device / "latency_timer"} << "16\n";
+
+    WHEN("setting the latency timer") {
+      const auto status =
+          sp::set_ftdi_latency_timer("/dev/ttyUSB0", 1, sysfs_root.c_str());
+      THEN("it is written to the driver attribute") {
+        CHECK(status == sp::status_t::OK);
+        CHECK(sp::get_ftdi_latency_timer("/dev/ttyUSB0", sysfs_root.c_str())
+              == 1);
+        CHECK(sp::get_status() == sp::status_t::OK);
+      }
+    }
+
+    WHEN("setting the latency timer of another port") {
+      THEN("it is not supported") {
+        CHECK(sp::set_ftdi_latency_timer("/dev/ttyS0", 1, sysfs_root.c_str())
+              == sp::status_t::NotSupported);
+        CHECK(sp::get_ftdi_latency_timer("/dev/ttyS0", sysfs_root.c_str())
+              == -1);
+        CHECK(sp::get_status() == sp::status_t::NotSupported);
+      }
+    }
+
+    WHEN("setting an invalid latency timer") {
+      THEN("it is rejected") {
+        CHECK(sp::set_ftdi_latency_timer("/dev/ttyUSB0", 0, sysfs_root.c_str())
+              == sp::status_t::InvalidArgument);
+      }
+    }
+
+    std::filesystem::remove_all(sysfs_root);
+  }
+
+  GIVEN("a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    WHEN("enabling the low-latency mode") {
+      const auto result = conn.set_low_latency(true);
+      THEN("nothing could be applied") {
+        CHECK(result.async_low_latency == sp::status_t::NotSupported);
+        CHECK(result.latency_timer == sp::status_t::NotSupported);
+        CHECK(result.latency_timer_ms == -1);
+        CHECK(sp::get_status() == sp::status_t::NotSupported);
+      }
+    }
+
+    WHEN("disabling the low-latency mode that has not been enabled") {
+      const auto result = conn.set_low_latency(false);
+      THEN("there is nothing to restore") {
+        CHECK(result.async_low_latency == sp::status_t::NotSupported);
+        CHECK(result.latency_timer == sp::status_t::NotSupported);
+        CHECK(sp::get_status() == sp::status_t::NotSupported);
+      }
+    }
+  }
+}
+
+SCENARIO("ports are listed without their metadata") {
+  GIVEN("a sysfs tree with a USB adapter, a UART and a virtual terminal") {
+    namespace fs = std::filesystem;
+    const auto sysfs_root =
+        fs::temp_directory_path()
+        / ("libspp_sysfs_tty_" + std::to_string(::getpid()));
+    const auto add_tty = [&](const std::string &name, const fs::path &device,
+                             const std::string &driver) {
+      const auto dir = sysfs_root / device / "tty" / name;
+      fs::create_directories(dir);
+      fs::create_directories(sysfs_root / "drivers" / driver);
+      fs::create_directories(sysfs_root / "class/tty");
+      fs::create_directory_symlink(dir, sysfs_root / "class/tty" / name);
+      fs::create_directory_symlink(sysfs_root / device, dir / "device");
+      fs::create_directory_symlink(sysfs_root / "drivers" / driver,
+                                   sysfs_root / device / "driver");
+    };
+    add_tty("ttyUSB0", "devices/pci0000:00/usb1/1-1/1-1:1.0/ttyUSB0",
+            "ftdi_sio");
+    add_tty("ttyAMA0", "devices/platform/serial0", "uart-pl011");
+    add_tty("tty0", "devices/virtual/tty0", "vt");
+
+    const auto lookups = sp_mock::number_of_detail_lookups();
+    auto ports = sp::list_ports(sp::metadata_t::Lazy, sysfs_root.c_str());
+    std::ranges::sort(ports, {}, [](const sp::port_t &p) {
+      return std::string{sp::get_name(p)};
+    });
+
+    THEN("the serial ports are listed with names and transports") {
+      REQUIRE(ports.size() == 2U);
+      CHECK(std::string{sp::get_name(ports[0])} == "/dev/ttyAMA0");
+      CHECK(sp::get_transport(ports[0]) == sp::transport_t::Native);
+      CHECK(std::string{sp::get_name(ports[1])} == "/dev/ttyUSB0");
+      CHECK(sp::get_transport(ports[1]) == sp::transport_t::USB);
+      CHECK(sp_mock::number_of_detail_lookups() == lookups);
+    }
+
+    WHEN("the metadata of a port is accessed") {
+      REQUIRE(ports.size() == 2U);
+      const auto serial_no = std::string{sp::get_usb_serial_no(ports[1])};
+      THEN("it is fetched once") {
+        CHECK(serial_no == "A50285BI");
+        CHECK(sp::get_usb_vid_pid(ports[1])
+              == sp::usb_vid_pid_t{0x0403, 0x6001});
+        CHECK(std::string{sp::get_usb_product(ports[1])} == "FT232R USB UART");
+        CHECK(sp_mock::number_of_detail_lookups() == lookups + 1);
+      }
+    }
+
+    WHEN("the ports are released") {
+      ports.clear();
+      THEN("nothing is left to fetch") {
+        CHECK(sp::fetch_metadata(sp::get_port_by_name(""))
+              == sp::status_t::OK);
+        CHECK(sp_mock::number_of_detail_lookups() == lookups);
+      }
+    }
+
+    fs::remove_all(sysfs_root);
+  }
+
+  GIVEN("a sysfs tree that cannot be scanned") {
+    THEN("ports are listed with all their metadata") {
+      CHECK(sp::list_ports(sp::metadata_t::Lazy, "/nonexistent").size()
+            == 2U);
+    }
+  }
+}
+
+SCENARIO("the baud rate in effect is reported") {
+  GIVEN("a requested and an achieved baud rate") {
+    THEN("the deviation is relative to the requested rate") {
+      STATIC_REQUIRE(sp::baud_rate_error(250'000, 250'000) == 0.0);
+      STATIC_REQUIRE(sp::baud_rate_error(100, 103) > 0.029);
+      STATIC_REQUIRE(sp::baud_rate_error(100, 97) < -0.029);
+    }
+  }
+
+  GIVEN("a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    THEN("the baud rate of the terminal is reported") {
+      REQUIRE(conn.set_buffer_sizes({}) == sp::status_t::NotSupported);
+      CHECK(conn.get_actual_baud_rate() > 0);
+      CHECK(sp::get_status() == sp::status_t::OK);
+    }
+    THEN("its buffers cannot be sized") {
+      CHECK(conn.set_buffer_sizes({.rx = 65'536, .tx = 4'096})
+            == sp::status_t::NotSupported);
+      CHECK(sp::get_status() == sp::status_t::NotSupported);
+      REQUIRE(conn.get_actual_baud_rate() > 0);
+      CHECK(conn.get_buffer_sizes().rx == -1);
+      CHECK(sp::get_status() == sp::status_t::NotSupported);
+    }
+  }
+}
+
+SCENARIO("reconnect attempts back off exponentially") {
+  GIVEN("a backoff without jitter") {
+    const auto backoff = sp::backoff_t{.initial = 100ms, .max = 1s, .jitter = 0};
+    THEN("the delay doubles with each failed attempt up to the maximum") {
+      CHECK(sp::backoff_delay(backoff, 0, 0.5) == 100ms);
+      CHECK(sp::backoff_delay(backoff, 1, 0.5) == 200ms);
+      CHECK(sp::backoff_delay(backoff, 3, 0.5) == 800ms);
+      CHECK(sp::backoff_delay(backoff, 4, 0.5) == 1s);
+      CHECK(sp::backoff_delay(backoff, 1'000, 0.5) == 1s);
+    }
+  }
+
+  GIVEN("a backoff with full jitter") {
+    const auto backoff = sp::backoff_t{.initial = 100ms, .max = 1s, .jitter = 1};
+    THEN("the delay is spread over the whole range") {
+      CHECK(sp::backoff_delay(backoff, 1, 0.0) == 0ms);
+      CHECK(sp::backoff_delay(backoff, 1, 0.5) == 100ms);
+    }
+  }
+}
+
+SCENARIO("ports are managed by their identity") {
+  GIVEN("a port manager") {
+    auto manager = sp::port_manager{};
+    const auto id = sp::port_identity_t{.usb_vid_pid = {0x0403, 0x6001},
+                                        .usb_serial_no = "A1B2C3"};
+
+    WHEN("adding an empty identity") {
+      THEN("it is rejected") {
+        CHECK(manager.add({}, sp::mode_t::ReadWrite)
+              == sp::status_t::InvalidArgument);
+      }
+    }
+
+    WHEN("accessing a port that is not managed") {
+      THEN("it is rejected") {
+        CHECK(manager.with_connection(id, [](sp::connection &) {})
+              == sp::status_t::InvalidArgument);
+        CHECK(manager.remove(id) == sp::status_t::InvalidArgument);
+      }
+    }
+
+    WHEN("adding a port that is not present") {
+      REQUIRE(manager.add(id, sp::mode_t::ReadWrite) == sp::status_t::OK);
+      THEN("it is managed, but not connected") {
+        CHECK(manager.add(id, sp::mode_t::ReadWrite)
+              == sp::status_t::InvalidArgument);
+        CHECK_FALSE(manager.is_connected(id));
+        CHECK(manager.with_connection(id, [](sp::connection &) {})
+              == sp::status_t::SystemError);
+        CHECK(manager.remove(id) == sp::status_t::OK);
+      }
+    }
+
+    WHEN("the same port is added by several threads at once") {
+      auto added = std::atomic<int>{0};
+      {
+        auto adders = std::vector<std::jthread>{};
+        for (auto i = 0; i < 8; ++i) {
+          adders.emplace_back([&] {
+            if (manager.add(id, sp::mode_t::ReadWrite) == sp::status_t::OK) {
+              ++added;
+            }
+          });
+        }
+      }
+      THEN("it is managed once") {
+        CHECK(added == 1);
+        CHECK(manager.remove(id) == sp::status_t::OK);
+        CHECK(manager.remove(id) == sp::status_t::InvalidArgument);
+      }
+    }
+  }
+
+  GIVEN("a port that appears while it is in use all the time") {
+    auto manager = sp::port_manager{{.initial = 1ms, .max = 2ms, .jitter = 0}};
+    const auto dir = std::filesystem::temp_directory_path()
+                     / ("libspp_manager_" + std::to_string(::getpid()));
+    std::filesystem::create_directories(dir);
+    const auto id = sp::port_identity_t{.path = (dir / "ttyUSB0").string()};
+    REQUIRE(manager.add(id, sp::mode_t::ReadWrite) == sp::status_t::OK);
+
+    WHEN("it is accessed throughout the reconnect rounds") {
+      // holds the entry while the supervisor tries to reconnect it
+      auto stop = std::atomic<bool>{false};
+      auto user = std::jthread{[&] {
+        while (!stop) {
+          manager.with_connection(id, [](sp::connection &) {});
+          manager.is_connected(id);
+        }
+      }};
+      std::this_thread::sleep_for(20ms);
+      std::filesystem::create_symlink("/dev/null", dir / "ttyUSB0");
+
+      THEN("it is connected nonetheless") {
+        const auto deadline = std::chrono::steady_clock::now() + 2s;
+        while (!manager.is_connected(id)
+               && std::chrono::steady_clock::now() < deadline) {
+          std::this_thread::sleep_for(1ms);
+        }
+        stop = true;
+        CHECK(manager.is_connected(id));
+      }
+    }
+    std::filesystem::remove_all(dir);
+  }
+}
+
+SCENARIO("operations are batched on many ports") {
+  GIVEN("a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    // reads may still be in flight when `io` goes, so the buffer outlives it
+    auto buf = std::array<std::byte, 4>{};
+    auto io = sp::batch_io{4U, GENERATE(true, false)};
+    auto completions = std::vector<sp::completion_t>{};
+
+    WHEN("waiting for a read without data arriving") {
+      REQUIRE(io.read(conn, buf, 1U) == sp::status_t::OK);
+      REQUIRE(io.wait(completions, 20) == sp::status_t::OK);
+      THEN("the read is still pending after the timeout") {
+        CHECK(completions.empty());
+        CHECK(io.pending() == 1U);
+        CHECK(sp::get_status() == sp::status_t::OK);
+      }
+    }
+
+    WHEN("queueing a read into an empty buffer") {
+      REQUIRE(io.read(conn, {}, 1U) == sp::status_t::InvalidArgument);
+      THEN("the status is set") {
+        CHECK(sp::get_status() == sp::status_t::InvalidArgument);
+        CHECK(io.pending() == 0U);
+      }
+    }
+
+    WHEN("writing to the port") {
+      const auto data = std::array<std::byte, 3>{
+          std::byte{'a'}, std::byte{'b'}, std::byte{'c'}};
+      REQUIRE(io.write(conn, data, 2U) == sp::status_t::OK);
+      REQUIRE(io.wait(completions, 1'000) == sp::status_t::OK);
+      THEN("the data arrives at the device") {
+        REQUIRE(completions.size() == 1U);
+        CHECK(completions[0].user_data == 2U);
+        CHECK(completions[0].result == 3);
+        auto received = std::array<char, 3>{};
+        CHECK(::read(pty.device(), received.data(), received.size()) == 3);
+        CHECK(std::memcmp(received.data(), data.data(), 3) == 0);
+      }
+    }
+  }
+}
+
+SCENARIO("requests are pipelined and matched to their responses") {
+  GIVEN("a transactor on a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    auto transactor =
+        sp::transactor{conn, sp::terminated_by(std::byte{'\n'}), 3U};
+    auto finished = std::vector<sp::response_t>{};
+    const auto request = std::array<std::byte, 2>{std::byte{'?'},
+                                                  std::byte{'\n'}};
+
+    WHEN("several requests are submitted") {
+      const auto deadline = std::chrono::steady_clock::now() + 10s;
+      const auto first = transactor.submit(request, deadline);
+      transactor.submit(request, deadline);
+      transactor.submit(request, deadline);
+      REQUIRE(transactor.process(finished, 20) == sp::status_t::OK);
+
+      THEN("they are all in flight at once") {
+        CHECK(finished.empty());
+        REQUIRE(sp_test::wait_readable(pty.device()));
+        auto received = std::array<char, 16>{};
+        CHECK(::read(pty.device(), received.data(), received.size()) == 6);
+      }
+
+      AND_WHEN("the device responds") {
+        REQUIRE(::write(pty.device(), "a\nb\nc\n", 6) == 6);
+        for (auto i = 0; i < 3 && transactor.pending() > 0U; ++i) {
+          REQUIRE(transactor.process(finished, 1'000) == sp::status_t::OK);
+        }
+        THEN("the responses are matched in order") {
+          REQUIRE(finished.size() == 3U);
+          CHECK(finished[0].id == first);
+          CHECK_FALSE(finished[0].timed_out);
+          CHECK(finished[2].data
+                == std::vector{std::byte{'c'}, std::byte{'\n'}});
+          CHECK(transactor.latencies().count == 3U);
+        }
+      }
+    }
+
+    WHEN("a request is not responded to") {
+      const auto response = transactor.transact(request, 10);
+      THEN("it times out") {
+        CHECK(response.status == sp::status_t::OK);
+        CHECK(response.timed_out);
+        CHECK(transactor.latencies().count == 0U);
+        CHECK(transactor.pending() == 0U);
+      }
+    }
+
+    WHEN("as many responses are lost as requests may be in flight") {
+      const auto now = std::chrono::steady_clock::now();
+      for (auto i = 0; i < 3; ++i) {
+        transactor.submit(request, now + 20ms);
+      }
+      const auto last = transactor.submit(request, now + 10s);
+      for (auto i = 0; i < 3 && finished.size() < 3U; ++i) {
+        REQUIRE(transactor.process(finished, 1'000) == sp::status_t::OK);
+      }
+      REQUIRE(finished.size() == 3U);
+      // the slots are freed after a while, which sends the last request
+      REQUIRE(transactor.process(finished, 200) == sp::status_t::OK);
+      auto received = std::array<char, 16>{};
+      REQUIRE(sp_test::wait_readable(pty.device()));
+      CHECK(::read(pty.device(), received.data(), received.size()) == 8);
+      REQUIRE(::write(pty.device(), "d\n", 2) == 2);
+      for (auto i = 0; i < 3 && transactor.pending() > 0U; ++i) {
+        REQUIRE(transactor.process(finished, 1'000) == sp::status_t::OK);
+      }
+      THEN("later requests are still responded to") {
+        REQUIRE(finished.size() == 4U);
+        CHECK(finished.back().id == last);
+        CHECK_FALSE(finished.back().timed_out);
+        CHECK(finished.back().data
+              == std::vector{std::byte{'d'}, std::byte{'\n'}});
+      }
+    }
+  }
+}
+
+SCENARIO("one payload is written to many ports") {
+  GIVEN("ports that are backed by pseudo terminals") {
+    auto ptys = std::array<sp_test::pty, 3>{};
+    auto conns = std::vector<sp::connection>{};
+    for (const auto &pty : ptys) {
+      const auto port = sp::get_port_by_name("");
+      sp_mock::set_native_handle(port, pty.port());
+      conns.emplace_back(port, sp::mode_t::ReadWrite);
+    }
+    auto conn_ptrs = std::vector<sp::connection *>{};
+    for (auto &conn : conns) {
+      conn_ptrs.push_back(&conn);
+    }
+
+    WHEN("a payload is written to all of them") {
+      const auto data = std::array<std::byte, 4>{
+          std::byte{'s'}, std::byte{'y'}, std::byte{'n'}, std::byte{'c'}};
+      const auto results =
+          sp::write_all(conn_ptrs, sp::make_payload(data), 1'000);
+      THEN("it arrives at every device") {
+        REQUIRE(results.size() == ptys.size());
+        for (auto i = 0U; i < ptys.size(); ++i) {
+          CHECK(results[i].status == sp::status_t::OK);
+          CHECK(results[i].written == 4);
+          REQUIRE(sp_test::wait_readable(ptys[i].device()));
+          auto received = std::array<char, 8>{};
+          CHECK(::read(ptys[i].device(), received.data(), received.size())
+                == 4);
+          CHECK(std::memcmp(received.data(), "sync", 4) == 0);
+        }
+      }
+    }
+
+    WHEN("one of the ports is missing") {
+      conn_ptrs[1] = nullptr;
+      const auto data = std::array<std::byte, 2>{std::byte{'o'},
+                                                 std::byte{'k'}};
+      const auto results =
+          sp::write_all(conn_ptrs, sp::make_payload(data), 1'000);
+      THEN("only that port is reported as invalid") {
+        REQUIRE(results.size() == ptys.size());
+        CHECK(results[0].status == sp::status_t::OK);
+        CHECK(results[0].written == 2);
+        CHECK(results[1].status == sp::status_t::InvalidArgument);
+        CHECK(results[1].written == 0);
+        CHECK(results[2].status == sp::status_t::OK);
+        CHECK(results[2].written == 2);
+      }
+    }
+
+    WHEN("an empty payload is written") {
+      const auto results = sp::write_all(conn_ptrs, sp::make_payload({}), 20);
+      THEN("it is written to all of them") {
+        for (const auto &result : results) {
+          CHECK(result.status == sp::status_t::OK);
+          CHECK(result.written == 0);
+        }
+      }
+    }
+
+    WHEN("a payload is more than the ports can take") {
+      const auto data = std::vector<std::byte>(1'000'000);
+      const auto results =
+          sp::write_all(conn_ptrs, sp::make_payload(data), 20);
+      THEN("the write times out with part of it written") {
+        for (const auto &result : results) {
+          CHECK(result.status == sp::status_t::OK);
+          CHECK(result.written > 0);
+          CHECK(result.written < 1'000'000);
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("received bytes are timestamped") {
+  GIVEN("a chunk of bytes that arrived back-to-back") {
+    const auto now = std::chrono::steady_clock::now();
+    const auto chunk = sp::rx_chunk_t{0, 3, now, false};
+    THEN("the arrival of each byte is estimated from the character time") {
+      CHECK(sp::byte_arrival(chunk, 2, 100) == now);
+      CHECK(sp::byte_arrival(chunk, 0, 100) == now - 200us);
+      CHECK(sp::byte_arrival(chunk, 0, -1) == now);
+    }
+  }
+
+  GIVEN("a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+    auto chunks = std::vector<sp::rx_chunk_t>{};
+    auto buf = std::array<char, 8>{};
+
+    WHEN("bytes are waiting before the read") {
+      REQUIRE(::write(pty.device(), "ab", 2) == 2);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      const auto before = std::chrono::steady_clock::now();
+      REQUIRE(conn.read_timestamped(buf.data(), 2, 100, chunks) == 2);
+      THEN("they are reported as backlogged") {
+        REQUIRE(chunks.size() == 1U);
+        CHECK(chunks[0].backlogged);
+        CHECK(chunks[0].timestamp >= before);
+      }
+    }
+
+    WHEN("bytes arrive during the read") {
+      auto device = std::jthread{[&pty] {
+        std::this_thread::sleep_for(20ms);
+        (void)::write(pty.device(), "ab", 2);
+      }};
+      const auto before = std::chrono::steady_clock::now();
+      const auto ret = conn.read_timestamped(buf.data(), 2, 1'000, chunks);
+      THEN("they are timestamped on arrival") {
+        CHECK(ret == 2);
+        REQUIRE_FALSE(chunks.empty());
+        CHECK_FALSE(chunks[0].backlogged);
+        CHECK(chunks[0].offset == 0);
+        CHECK(chunks[0].timestamp - before >= 20ms);
+      }
+    }
+
+    WHEN("no bytes arrive") {
+      THEN("the read times out without chunks") {
+        CHECK(conn.read_timestamped(buf.data(), 2, 10, chunks) == 0);
+        CHECK(chunks.empty());
+      }
+    }
+  }
+}
+
+SCENARIO("line errors are reported in-band") {
+  GIVEN("a decoder of marked data") {
+    auto decoder = sp::parmrk_decoder{};
+    auto events = std::vector<sp::line_event_t>{};
+
+    WHEN("data with an error, a break and an escaped byte is decoded") {
+      auto data = std::array<char, 10>{'a', '\377', '\0', 'b',   'c',
+                                       '\377', '\0', '\0', '\377', '\377'};
+      const auto count = decoder.decode(data.data(), 10, events);
+      THEN("the marks are removed and the errors reported") {
+        REQUIRE(count == 4);
+        CHECK(std::memcmp(data.data(), "abc\377", 4) == 0);
+        REQUIRE(events.size() == 2U);
+        CHECK(events[0].position == 1);
+        CHECK(events[0].error == sp::line_error_t::ParityOrFraming);
+        CHECK(events[1].position == 3);
+        CHECK(events[1].error == sp::line_error_t::Break);
+      }
+    }
+
+    WHEN("a mark is split across reads") {
+      auto first = std::array<char, 2>{'a', '\377'};
+      auto second = std::array<char, 2>{'\0', 'b'};
+      CHECK(decoder.decode(first.data(), 2, events) == 1);
+      CHECK(decoder.decode(second.data(), 2, events) == 1);
+      THEN("it is decoded all the same") {
+        CHECK(second[0] == 'b');
+        REQUIRE(events.size() == 1U);
+        CHECK(events[0].position == 0);
+      }
+    }
+  }
+
+  GIVEN("a port that is backed by the terminal end of a pseudo terminal") {
+    // the line discipline that marks errors is that of the terminal end
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.device());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    WHEN("error marking is enabled") {
+      REQUIRE(conn.set_error_marking(true) == sp::status_t::OK);
+      AND_WHEN("bytes that need escaping are received") {
+        REQUIRE(::write(pty.port(), "a\377b", 3) == 3);
+        auto events = std::vector<sp::line_event_t>{};
+        auto buf = std::array<char, 8>{};
+        auto count = 0;
+        while (count < 3) {
+          const auto ret =
+              conn.read_marked(buf.data() + count,
+                               static_cast<int>(buf.size()) - count, 1'000,
+                               events);
+          REQUIRE(ret > 0);
+          count += ret;
+        }
+        THEN("they are read as they were sent") {
+          CHECK(count == 3);
+          CHECK(std::memcmp(buf.data(), "a\377b", 3) == 0);
+          CHECK(events.empty());
+        }
+      }
+
+      AND_WHEN("the port is configured afterwards") {
+        REQUIRE(conn.set_config({.baud_rate = 9'600,
+                                 .bits = 8,
+                                 .stop_bits = 1,
+                                 .parity = sp::parity_t::None})
+                == sp::status_t::OK);
+        THEN("errors are still marked rather than ignored") {
+          auto tio = termios{};
+          REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+          CHECK((tio.c_iflag & PARMRK) != 0U);
+          CHECK((tio.c_iflag & IGNPAR) == 0U);
+        }
+        AND_WHEN("error marking is disabled") {
+          REQUIRE(conn.set_error_marking(false) == sp::status_t::OK);
+          THEN("parity errors are ignored as configured") {
+            auto tio = termios{};
+            REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+            CHECK((tio.c_iflag & PARMRK) == 0U);
+            CHECK((tio.c_iflag & IGNPAR) != 0U);
+          }
+        }
+      }
+    }
+
+    WHEN("error marking is disabled without having been enabled") {
+      auto tio = termios{};
+      REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+      tio.c_iflag |= INPCK;
+      REQUIRE(::tcsetattr(pty.device(), TCSANOW, &tio) == 0);
+      REQUIRE(conn.set_error_marking(false) == sp::status_t::OK);
+      THEN("the flags are left alone") {
+        REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+        CHECK((tio.c_iflag & INPCK) != 0U);
+      }
+    }
+
+    WHEN("error marking is disabled again") {
+      auto tio = termios{};
+      REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+      tio.c_iflag |= IGNBRK | BRKINT | ISTRIP;
+      tio.c_iflag &= ~static_cast<tcflag_t>(INPCK);
+      REQUIRE(::tcsetattr(pty.device(), TCSANOW, &tio) == 0);
+      REQUIRE(conn.set_error_marking(true) == sp::status_t::OK);
+      REQUIRE(conn.set_error_marking(false) == sp::status_t::OK);
+      THEN("the flags that it changed are restored") {
+        REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+        CHECK((tio.c_iflag & (IGNBRK | BRKINT | ISTRIP))
+              == (IGNBRK | BRKINT | ISTRIP));
+        CHECK((tio.c_iflag & (PARMRK | INPCK)) == 0U);
+      }
+      AND_WHEN("the port is configured afterwards") {
+        REQUIRE(conn.set_config({.baud_rate = 9'600,
+                                 .bits = 8,
+                                 .stop_bits = 1,
+                                 .parity = sp::parity_t::None})
+                == sp::status_t::OK);
+        THEN("the configuration is left as it is") {
+          auto tio = termios{};
+          REQUIRE(::tcgetattr(pty.device(), &tio) == 0);
+          CHECK((tio.c_iflag & PARMRK) == 0U);
+          CHECK((tio.c_iflag & IGNPAR) != 0U);
+        }
+      }
+    }
+
+    THEN("a break can be sent") {
+      CHECK(conn.send_break(1) == sp::status_t::OK);
+      CHECK(conn.send_break(0) == sp::status_t::InvalidArgument);
+    }
+  }
+}
+
+SCENARIO("writes are queued and drained in the background") {
+  GIVEN("a write queue on a port whose device does not read") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    // fills the buffers of the pseudo terminal, so that nothing drains
+    // data moves on between its buffers asynchronously, so it is topped up
+    // until it has settled
+    auto filler = std::array<char, 4'096>{};
+    auto filled = std::size_t{0};
+    for (auto settled = false; !settled;) {
+      settled = true;
+      for (auto ret = ::write(pty.port(), filler.data(), filler.size());
+           ret > 0; ret = ::write(pty.port(), filler.data(), filler.size())) {
+        filled += static_cast<std::size_t>(ret);
+        settled = false;
+      }
+      std::this_thread::sleep_for(20ms);
+    }
+
+    auto queue = sp::write_queue{conn, {.capacity = 8U,
+                                        .high_watermark = 6U,
+                                        .low_watermark = 2U,
+                                        .max_output_waiting = -1}};
+    auto highs = std::atomic<int>{0};
+    auto lows = std::atomic<int>{0};
+    queue.on_high_watermark([&highs] { ++highs; });
+    queue.on_low_watermark([&lows] { ++lows; });
+    const auto data = std::array<std::byte, 8>{};
+
+    WHEN("the queue is filled") {
+      REQUIRE(queue.write_nonblocking(data) == 8);
+
+      THEN("producers are held back") {
+        CHECK(highs == 1);
+        CHECK(queue.write_nonblocking(std::span{data}.first(1)) == 0);
+        CHECK(queue.write_blocking(std::span{data}.first(1), 10) == 0);
+        CHECK(queue.write_nonblocking(std::array<std::byte, 9>{}) == -1);
+      }
+
+      AND_WHEN("the device starts reading") {
+        auto pending = queue.write_async(std::span{data}.first(4));
+        CHECK(pending.wait_for(10ms) == std::future_status::timeout);
+
+        auto drained = std::size_t{0};
+        auto buf = std::array<char, 4'096>{};
+        while (drained < filled + 12U) {
+          REQUIRE(sp_test::wait_readable(pty.device()));
+          const auto ret = ::read(pty.device(), buf.data(), buf.size());
+          REQUIRE(ret > 0);
+          drained += static_cast<std::size_t>(ret);
+        }
+
+        THEN("the queue drains") {
+          CHECK(pending.get() == 4);
+          CHECK(queue.drain(1'000));
+          CHECK(queue.size() == 0U);
+          CHECK(lows >= 1);
+          CHECK(queue.get_status() == sp::status_t::OK);
+        }
+      }
+    }
+  }
+
+  GIVEN("a write queue on a port whose device reads all the time") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    auto queue = sp::write_queue{conn, {.capacity = 16U,
+                                        .high_watermark = 8U,
+                                        .low_watermark = 4U,
+                                        .max_output_waiting = -1}};
+    auto mutex = std::mutex{};
+    auto crossed = std::string{};
+    queue.on_high_watermark([&] {
+      const auto lock = std::lock_guard{mutex};
+      crossed.push_back('h');
+    });
+    queue.on_low_watermark([&] {
+      const auto lock = std::lock_guard{mutex};
+      crossed.push_back('l');
+    });
+
+    WHEN("the watermarks are crossed by producer and drainer alike") {
+      {
+        auto device = std::jthread{[&pty](const std::stop_token &stop) {
+          auto buf = std::array<char, 4'096>{};
+          while (!stop.stop_requested()) {
+            if (sp_test::wait_readable(pty.device(), 10)) {
+              static_cast<void>(::read(pty.device(), buf.data(), buf.size()));
+            }
+          }
+        }};
+        const auto data = std::array<std::byte, 5>{};
+        auto queued = 0;
+        for (auto i = 0; i < 2'000; ++i) {
+          queued += queue.write_blocking(data, 1'000);
+        }
+        REQUIRE(queued == 10'000);
+        REQUIRE(queue.drain(1'000));
+      }
+
+      THEN("the callbacks are called in the order of the crossings") {
+        const auto lock = std::lock_guard{mutex};
+        REQUIRE_FALSE(crossed.empty());
+        CHECK(crossed.front() == 'h');
+        CHECK(crossed.back() == 'l');
+        CHECK(std::ranges::adjacent_find(crossed) == crossed.end());
+      }
+    }
+  }
+}
+
+SCENARIO("work is handed off between threads without locking") {
+  GIVEN("a handoff queue") {
+    auto queue = sp::handoff_queue<int>{3U};
+
+    WHEN("it is filled") {
+      auto pushed = 0;
+      for (auto i = 0; i < 8; ++i) {
+        pushed += queue.try_push(int{i}) ? 1 : 0;
+      }
+      THEN("its capacity is rounded up to a power of two") {
+        CHECK(pushed == 4);
+      }
+      THEN("values are popped in order") {
+        CHECK(queue.try_pop() == 0);
+        CHECK(queue.try_pop() == 1);
+        CHECK(queue.try_push(8));
+        CHECK(queue.try_pop() == 2);
+        CHECK(queue.try_pop() == 3);
+        CHECK(queue.try_pop() == 8);
+        CHECK_FALSE(queue.try_pop());
+        CHECK(queue.empty());
+      }
+    }
+
+    WHEN("several threads push at once") {
+      constexpr auto per_producer = 1'000;
+      auto producers = std::vector<std::jthread>{};
+      for (auto p = 0; p < 4; ++p) {
+        producers.emplace_back([&queue] {
+          for (auto i = 1; i <= per_producer; ++i) {
+            while (!queue.try_push(int{i})) {
+              std::this_thread::yield();
+            }
+          }
+        });
+      }
+      auto sum = 0L;
+      for (auto popped = 0; popped < 4 * per_producer;) {
+        if (const auto value = queue.try_pop()) {
+          sum += *value;
+          ++popped;
+        } else {
+          std::this_thread::yield();
+        }
+      }
+      THEN("every value arrives exactly once") {
+        CHECK(sum == 4L * per_producer * (per_producer + 1) / 2);
+      }
+    }
+  }
+}
+
+SCENARIO("ports are sharded across pinned workers") {
+  GIVEN("a runtime with two shards") {
+    auto ptys = std::array<sp_test::pty, 2>{};
+    auto received = std::array<std::promise<std::string>, 2>{};
+
+    // declared last, so that the workers stop before the above goes away
+    const auto cpus = std::array{0, -1};
+    auto runtime = sp::sharded_runtime{cpus};
+    REQUIRE(runtime.shards() == 2U);
+    CHECK(runtime.get_status() == sp::status_t::OK);
+    CHECK(runtime.get_affinity_status(1U) == sp::status_t::NotSupported);
+
+    auto ids = std::array<std::size_t, 2>{};
+    for (auto i = 0U; i < ptys.size(); ++i) {
+      const auto port = sp::get_port_by_name("");
+      sp_mock::set_native_handle(port, ptys[i].port());
+      const auto id = runtime.add(
+          sp::connection{port, sp::mode_t::ReadWrite},
+          [&promise = received[i]](sp::connection &,
+                                   const std::span<const std::byte> data) {
+            if (!data.empty()) {
+              promise.set_value({reinterpret_cast<const char *>(data.data()),
+                                 data.size()});
+            }
+          });
+      REQUIRE(id.has_value());
+      ids[i] = *id;
+    }
+
+    THEN("they are assigned round-robin") {
+      CHECK(runtime.shard_of(ids[0]) != runtime.shard_of(ids[1]));
+    }
+
+    WHEN("data arrives at the ports") {
+      REQUIRE(::write(ptys[0].device(), "a", 1) == 1);
+      REQUIRE(::write(ptys[1].device(), "b", 1) == 1);
+      THEN("it is handed to the shards that own them") {
+        auto first = received[0].get_future();
+        auto second = received[1].get_future();
+        REQUIRE(first.wait_for(1s) == std::future_status::ready);
+        REQUIRE(second.wait_for(1s) == std::future_status::ready);
+        CHECK(first.get() == "a");
+        CHECK(second.get() == "b");
+      }
+    }
+
+    WHEN("a task is posted to a port") {
+      REQUIRE(runtime.post(ids[1], [](sp::connection &conn) {
+        conn.write_nonblocking("ping", 4);
+      }));
+      THEN("it runs on the port") {
+        REQUIRE(sp_test::wait_readable(ptys[1].device()));
+        auto buf = std::array<char, 8>{};
+        CHECK(::read(ptys[1].device(), buf.data(), buf.size()) == 4);
+        CHECK(std::memcmp(buf.data(), "ping", 4) == 0);
+      }
+    }
+
+    WHEN("a task is posted to a port of the pinned shard") {
+      auto ran_on = std::promise<int>{};
+      REQUIRE(runtime.post(ids[0], [&ran_on](sp::connection &) {
+        ran_on.set_value(::sched_getcpu());
+      }));
+      THEN("it runs on the CPU of the shard") {
+        auto cpu = ran_on.get_future();
+        REQUIRE(cpu.wait_for(1s) == std::future_status::ready);
+        if (runtime.get_affinity_status(0U) == sp::status_t::OK) {
+          CHECK(cpu.get() == 0);
+        }
+      }
+    }
+
+    WHEN("a port is removed") {
+      REQUIRE(runtime.remove(ids[0]));
+      THEN("tasks posted to it are dropped") {
+        auto ran = std::promise<void>{};
+        CHECK(runtime.post(ids[0], [&ran](sp::connection &) {
+          ran.set_value();
+        }));
+        CHECK(ran.get_future().wait_for(50ms) == std::future_status::timeout);
+      }
+    }
+  }
+
+  GIVEN("a runtime without any shards") {
+    auto runtime = sp::sharded_runtime{std::span<const int>{}};
+    WHEN("a port is added") {
+      const auto id = runtime.add(
+          sp::connection{sp::get_port_by_name(""), sp::mode_t::ReadWrite},
+          [](sp::connection &, std::span<const std::byte>) {});
+      THEN("it is rejected") {
+        CHECK_FALSE(id.has_value());
+        CHECK(runtime.get_status() == sp::status_t::OK);
+        CHECK(sp::get_status() == sp::status_t::InvalidArgument);
+      }
+    }
+  }
+}
+
+SCENARIO("connections are read and written through preallocated buffers") {
+  GIVEN("a real-time setup of a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+    // neither locking memory nor real-time priorities are up to a test
+    auto rt = sp::realtime{conn, {.lock_memory = false,
+                                  .priority = -1,
+                                  .low_latency = false,
+                                  .rx_buffer_size = 16U,
+                                  .tx_buffer_size = 16U}};
+
+    THEN("nothing has been changed that was not asked for") {
+      CHECK(rt.get_realtime_status().memory_locked
+            == sp::status_t::NotSupported);
+      CHECK(rt.get_realtime_status().scheduling == sp::status_t::NotSupported);
+      CHECK(rt.tx_buffer().size() == 16U);
+    }
+
+    WHEN("data is written") {
+      std::memcpy(rt.tx_buffer().data(), "ping", 4);
+      REQUIRE(rt.write(4U, 100) == 4);
+      THEN("it arrives at the device") {
+        REQUIRE(sp_test::wait_readable(pty.device()));
+        auto buf = std::array<char, 8>{};
+        CHECK(::read(pty.device(), buf.data(), buf.size()) == 4);
+      }
+    }
+
+    WHEN("data is received") {
+      REQUIRE(::write(pty.device(), "pong", 4) == 4);
+      const auto data = rt.read(1'000);
+      THEN("it is read into the preallocated buffer") {
+        REQUIRE_FALSE(data.empty());
+        CHECK(std::memcmp(data.data(), "pong", data.size()) == 0);
+      }
+    }
+
+    WHEN("no data is received") {
+      THEN("the read times out") {
+        CHECK(rt.read(10).empty());
+      }
+    }
+  }
+}
+
+SCENARIO("reads are scattered across several buffers") {
+  GIVEN("a port that is backed by a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.port());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+
+    auto slots = std::array<std::array<std::byte, 3>, 3>{};
+    const auto bufs = std::array<std::span<std::byte>, 3>{
+        slots[0], std::span{slots[1]}.first(0), slots[2]};
+    const auto text = [](const std::span<const std::byte> slot) {
+      return std::string{reinterpret_cast<const char *>(slot.data()),
+                         slot.size()};
+    };
+
+    WHEN("data arrives") {
+      REQUIRE(::write(pty.device(), "abcdef", 6) == 6);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      THEN("it fills the buffers in order") {
+        CHECK(conn.read_blocking(bufs, 1'000) == 6);
+        CHECK(text(slots[0]) == "abc");
+        CHECK(text(slots[2]) == "def");
+      }
+    }
+
+    WHEN("less data arrives than fits") {
+      REQUIRE(::write(pty.device(), "abcd", 4) == 4);
+      REQUIRE(sp_test::wait_readable(pty.port()));
+      THEN("a blocking read times out with what has arrived") {
+        CHECK(conn.read_blocking(bufs, 20) == 4);
+        CHECK(text(slots[0]) == "abc");
+        CHECK(text(slots[2]).front() == 'd');
+      }
+      THEN("the other reads return what has arrived") {
+        auto read = conn.read_next_blocking(bufs, 1'000);
+        while (read < 4) {
+          REQUIRE(sp_test::wait_readable(pty.port()));
+          read += conn.read_nonblocking(std::span{bufs}.last(1));
+        }
+        CHECK(read == 4);
+      }
+    }
+
+    WHEN("no data arrives") {
+      THEN("reads return nothing") {
+        CHECK(conn.read_nonblocking(bufs) == 0);
+        CHECK(conn.read_next_blocking(bufs, 10) == 0);
+      }
+    }
+
+    WHEN("the buffers are empty") {
+      THEN("reads fail") {
+        CHECK(conn.read_nonblocking(std::span{bufs}.subspan(1, 1)) == -1);
+        CHECK(sp::get_status() == sp::status_t::InvalidArgument);
+      }
+    }
+  }
+
+  GIVEN("a port that is backed by the terminal end of a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.device());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+    auto slot = std::array<std::byte, 4>{};
+    const auto bufs = std::array<std::span<std::byte>, 1>{slot};
+
+    WHEN("the terminal is hung up") {
+      pty.close_port();
+      THEN("a blocking read fails rather than waiting out its timeout") {
+        const auto start = std::chrono::steady_clock::now();
+        CHECK(conn.read_blocking(bufs, 2'000) == -1);
+        CHECK(sp::get_status() == sp::status_t::SystemError);
+        CHECK(std::chrono::steady_clock::now() - start < 1s);
+      }
+    }
+  }
+}
+
+SCENARIO("two connections are bridged in both directions") {
+  GIVEN("a bridge between ports that are backed by pseudo terminals") {
+    const auto use_splice = GENERATE(true, false);
+    auto pty_a = sp_test::pty{};
+    auto pty_b = sp_test::pty{};
+    // outlives the bridge, which writes to it until it is destroyed
+    const auto capture = sp_test::pipe{};
+    const auto port_a = sp::get_port_by_name("");
+    const auto port_b = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port_a, pty_a.port());
+    sp_mock::set_native_handle(port_b, pty_b.port());
+    auto a = sp::connection{port_a, sp::mode_t::ReadWrite};
+    auto b = sp::connection{port_b, sp::mode_t::ReadWrite};
+
+    const auto receive = [](const int fd, const std::size_t count) {
+      auto received = std::string{};
+      auto buf = std::array<char, 64>{};
+      while (received.size() < count && sp_test::wait_readable(fd)) {
+        const auto ret = ::read(fd, buf.data(), buf.size());
+        if (ret > 0) {
+          received.append(buf.data(), static_cast<std::size_t>(ret));
+        }
+      }
+      return received;
+    };
+
+    auto bridge =
+        sp::bridge{a, b,
+                   {.capture_a_to_b = capture.write_end(),
+                    .use_splice = use_splice}};
+    REQUIRE(bridge.get_status() == sp::status_t::OK);
+    if (!use_splice) {
+      CHECK_FALSE(bridge.is_zero_copy());
+    }
+
+    WHEN("data arrives on either port") {
+      REQUIRE(::write(pty_a.device(), "request", 7) == 7);
+      REQUIRE(::write(pty_b.device(), "response", 8) == 8);
+      THEN("it is passed on to the other port") {
+        CHECK(receive(pty_b.device(), 7) == "request");
+        CHECK(receive(pty_a.device(), 8) == "response");
+      }
+      THEN("it is counted") {
+        // the count is updated after the data has been passed on
+        const auto until =
+            std::chrono::steady_clock::now() + std::chrono::seconds{1};
+        while (bridge.get_stats().a_to_b + bridge.get_stats().b_to_a < 15U
+               && std::chrono::steady_clock::now() < until) {
+          std::this_thread::yield();
+        }
+        CHECK(bridge.get_stats().a_to_b == 7U);
+        CHECK(bridge.get_stats().b_to_a == 8U);
+      }
+      THEN("the direction that is tapped is captured") {
+        CHECK(receive(capture.read_end(), 7) == "request");
+      }
+    }
+
+    WHEN("more is relayed than the capture sink takes") {
+      // the pipe is never read, so it fills up after 64 KiB
+      constexpr auto total = std::size_t{256U * 1'024U};
+      auto writer = std::jthread{[&pty_a] {
+        const auto chunk = std::string(4'096U, 'x');
+        for (auto written = std::size_t{0}; written < total;) {
+          const auto ret =
+              ::write(pty_a.device(), chunk.data(),
+                      std::min(chunk.size(), total - written));
+          if (ret > 0) {
+            written += static_cast<std::size_t>(ret);
+          } else {
+            auto pfd = pollfd{pty_a.device(), POLLOUT, 0};
+            ::poll(&pfd, 1, 10);
+          }
+        }
+      }};
+      auto received = std::size_t{0};
+      auto buf = std::array<char, 4'096>{};
+      while (received < total && sp_test::wait_readable(pty_b.device())) {
+        const auto ret = ::read(pty_b.device(), buf.data(), buf.size());
+        if (ret > 0) {
+          received += static_cast<std::size_t>(ret);
+        }
+      }
+      THEN("relaying goes on, and what the sink misses is counted") {
+        CHECK(received == total);
+        CHECK(bridge.get_stats().dropped_a_to_b > 0U);
+        CHECK(bridge.get_stats().dropped_b_to_a == 0U);
+      }
+    }
+
+    WHEN("the device on one port is unplugged") {
+      pty_b.close_device();
+      REQUIRE(::write(pty_a.device(), "x", 1) == 1);
+      THEN("the bridge stops") {
+        const auto until =
+            std::chrono::steady_clock::now() + std::chrono::seconds{1};
+        while (bridge.get_status() == sp::status_t::OK
+               && std::chrono::steady_clock::now() < until) {
+          std::this_thread::yield();
+        }
+        CHECK(bridge.get_status() == sp::status_t::SystemError);
+      }
+    }
+  }
+}
+
+SCENARIO("ports are served to network clients through RFC 2217") {
+  GIVEN("a server of two ports that are backed by pseudo terminals") {
+    auto pty_a = sp_test::pty{};
+    auto pty_b = sp_test::pty{};
+    const auto port_a = sp::get_port_by_name("");
+    const auto port_b = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port_a, pty_a.port());
+    sp_mock::set_native_handle(port_b, pty_b.port());
+    auto a = sp::connection{port_a, sp::mode_t::ReadWrite};
+    auto b = sp::connection{port_b, sp::mode_t::ReadWrite};
+
+    auto server = sp::rfc2217_server{};
+    const auto tcp_port_a = server.listen(a, 0U);
+    const auto tcp_port_b = server.listen(b, 0U);
+    REQUIRE(tcp_port_a.has_value());
+    REQUIRE(tcp_port_b.has_value());
+
+    const auto connect_to = [](const std::uint16_t tcp_port) {
+      const auto fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+      auto addr = sockaddr_in{};
+      addr.sin_family = AF_INET;
+      addr.sin_port = htons(tcp_port);
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      ::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof(addr));
+      return fd;
+    };
+    // serves until the client has received what is expected
+    auto received = std::string{};
+    const auto receive = [&](const int fd, const std::string_view expected) {
+      const auto until =
+          std::chrono::steady_clock::now() + std::chrono::seconds{1};
+      auto buf = std::array<char, 256>{};
+      while (received.find(expected) == std::string::npos
+             && std::chrono::steady_clock::now() < until) {
+        server.serve(10);
+        const auto ret = ::recv(fd, buf.data(), buf.size(), 0);
+        if (ret > 0) {
+          received.append(buf.data(), static_cast<std::size_t>(ret));
+        }
+      }
+      return received.find(expected) != std::string::npos;
+    };
+    const auto send = [](const int fd, const std::string_view data) {
+      return ::send(fd, data.data(), data.size(), 0)
+             == static_cast<ssize_t>(data.size());
+    };
+
+    const auto client = connect_to(*tcp_port_a);
+    // the server asks the client to enable the com port option
+    REQUIRE(receive(client, "\xff\xfd\x2c"));
+    REQUIRE(server.clients() == 1U);
+
+    WHEN("the client sets the baud rate") {
+      REQUIRE(send(client, "\xff\xfb\x2c\xff\xfa\x2c\x01"
+                           "\x00\x00\x25\x80\xff\xf0"sv));
+      THEN("it is applied and confirmed") {
+        CHECK(receive(client, "\xff\xfa\x2c\x65\x00\x00\x25\x80\xff\xf0"sv));
+        CHECK(a.get_config().baud_rate == 9'600);
+      }
+    }
+
+    WHEN("the client sets the framing") {
+      REQUIRE(send(client, "\xff\xfa\x2c\x02\x07\xff\xf0"
+                           "\xff\xfa\x2c\x03\x03\xff\xf0"
+                           "\xff\xfa\x2c\x04\x02\xff\xf0"sv));
+      THEN("it is applied and confirmed") {
+        CHECK(receive(client, "\xff\xfa\x2c\x68\x02\xff\xf0"));
+        CHECK(a.get_config().bits == 7);
+        CHECK(a.get_config().parity == sp::parity_t::Even);
+        CHECK(a.get_config().stop_bits == 2);
+      }
+    }
+
+    WHEN("the client asks for the settings without changing them") {
+      a.set_config({.baud_rate = 115'200});
+      REQUIRE(send(client, "\xff\xfa\x2c\x01\x00\x00\x00\x00\xff\xf0"sv));
+      THEN("the current ones are reported") {
+        CHECK(receive(client, "\xff\xfa\x2c\x65\x00\x01\xc2\x00\xff\xf0"sv));
+        CHECK(a.get_config().baud_rate == 115'200);
+      }
+    }
+
+    WHEN("data is exchanged") {
+      REQUIRE(send(client, "ab\xff\xff" "c"));
+      REQUIRE(::write(pty_a.device(), "x\xffy", 3) == 3);
+      THEN("it reaches the other side, with telnet escapes undone") {
+        CHECK(receive(client, "x\xff\xffy"));
+        REQUIRE(sp_test::wait_readable(pty_a.device()));
+        auto buf = std::array<char, 8>{};
+        CHECK(std::string{buf.data(),
+                          static_cast<std::size_t>(
+                              ::read(pty_a.device(), buf.data(), buf.size()))}
+              == "ab\xff" "c");
+      }
+      THEN("the other port is not involved") {
+        CHECK_FALSE(sp_test::wait_readable(pty_b.device(), 50));
+      }
+    }
+
+    WHEN("another client connects to the same port") {
+      const auto other = connect_to(*tcp_port_a);
+      THEN("it is turned away") {
+        auto buf = std::array<char, 8>{};
+        auto ret = ssize_t{-1};
+        for (auto i = 0; i < 100 && ret < 0; ++i) {
+          server.serve(10);
+          ret = ::recv(other, buf.data(), buf.size(), 0);
+        }
+        CHECK(ret == 0);
+        CHECK(server.clients() == 1U);
+      }
+      ::close(other);
+    }
+
+    WHEN("a client connects to the other port") {
+      const auto other = connect_to(*tcp_port_b);
+      REQUIRE(::write(pty_b.device(), "z", 1) == 1);
+      THEN("both are served") {
+        CHECK(receive(other, "z"));
+        CHECK(server.clients() == 2U);
+      }
+      ::close(other);
+    }
+
+    WHEN("the client disconnects") {
+      ::close(client);
+      THEN("the port is free again") {
+        for (auto i = 0; i < 100 && server.clients() > 0U; ++i) {
+          server.serve(10);
+        }
+        CHECK(server.clients() == 0U);
+      }
+    }
+    ::close(client);
+  }
+}
+
+SCENARIO("many ports are opened and configured at once") {
+  GIVEN("ports that are backed by pseudo terminals") {
+    auto ptys = std::vector<sp_test::pty>(5U);
+    auto ports = std::vector<sp::port_t>{};
+    for (const auto &pty : ptys) {
+      ports.push_back(sp::get_port_by_name(""));
+      sp_mock::set_native_handle(ports.back(), pty.port());
+    }
+    const auto cfg = sp::port_config_t{.baud_rate = 57'600,
+                                       .bits = 8,
+                                       .stop_bits = 1,
+                                       .parity = sp::parity_t::None};
+
+    WHEN("they are opened with fewer workers than ports") {
+      const auto workers = GENERATE(1U, 2U, 16U);
+      auto results = sp::open_all(ports, sp::mode_t::ReadWrite, cfg, workers);
+      THEN("all of them are opened and configured, in order") {
+        REQUIRE(results.size() == ports.size());
+        for (auto i = 0U; i < results.size(); ++i) {
+          REQUIRE(results[i].status == sp::status_t::OK);
+          REQUIRE(results[i].conn.has_value());
+          CHECK(results[i].conn->get_port() == ports[i]);
+          CHECK(results[i].conn->get_config().baud_rate == 57'600);
+        }
+      }
+    }
+
+    WHEN("a port cannot be opened") {
+      const auto not_a_tty = ::open("/dev/null", O_RDWR);
+      sp_mock::set_native_handle(ports[2], not_a_tty);
+      const auto results = sp::open_all(ports, sp::mode_t::ReadWrite, cfg);
+      ::close(not_a_tty);
+      THEN("it is reported without holding up the others") {
+        CHECK_FALSE(results[2].conn.has_value());
+        CHECK(results[2].status != sp::status_t::OK);
+        CHECK(std::ranges::count_if(results, [](const auto &r) {
+                return r.conn.has_value();
+              })
+              == 4);
+      }
+    }
+
+    WHEN("there are no ports") {
+      THEN("nothing is opened") {
+        CHECK(sp::open_all({}, sp::mode_t::ReadWrite).empty());
+      }
+    }
+  }
+}
+
+SCENARIO("files are transferred through XMODEM-1K, YMODEM and ZMODEM") {
+  // a short last block, and every byte that ZMODEM escapes
+  auto image = std::vector<std::byte>(4'200U);
+  for (auto i = 0U; i < image.size(); ++i) {
+    image[i] = std::byte(static_cast<unsigned char>(i * 7U ^ i >> 8U));
+  }
+
+  GIVEN("a sender and a receiver on the two ends of a pseudo terminal") {
+    auto pty = sp_test::pty{};
+    const auto port_tx = sp::get_port_by_name("");
+    const auto port_rx = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port_tx, pty.port());
+    sp_mock::set_native_handle(port_rx, pty.device());
+    auto tx = sp::connection{port_tx, sp::mode_t::ReadWrite};
+    auto rx = sp::connection{port_rx, sp::mode_t::ReadWrite};
+
+    const auto transfer = [&](const sp::transfer_options_t &options,
+                              std::vector<std::byte> &received,
+                              const sp::transfer_options_t *sender = nullptr) {
+      auto receiver = std::async(std::launch::async, [&] {
+        return sp::receive(rx, received, options);
+      });
+      auto sent = sp::send(tx, image, "image.bin", sender ? *sender : options);
+      return std::pair{std::move(sent), receiver.get()};
+    };
+
+    WHEN("a file is sent") {
+      const auto protocol =
+          GENERATE(sp::transfer_protocol_t::XModem1K,
+                   sp::transfer_protocol_t::YModem,
+                   sp::transfer_protocol_t::ZModem);
+      const auto streaming = GENERATE(false, true);
+      auto positions = std::vector<std::uint64_t>{};
+      const auto options = sp::transfer_options_t{.protocol = protocol,
+                                                  .timeout_ms = 2'000,
+                                                  .streaming = streaming,
+                                                  .window = 2'048U};
+      auto sender = options;
+      sender.on_progress = [&](const std::uint64_t position, std::uint64_t) {
+        positions.push_back(position);
+      };
+      auto received = std::vector<std::byte>{};
+      const auto [sent, got] = transfer(options, received, &sender);
+      THEN("it arrives intact") {
+        CHECK(sent.error == sp::transfer_error_t::None);
+        CHECK(got.error == sp::transfer_error_t::None);
+        CHECK(sent.bytes == image.size());
+        if (protocol == sp::transfer_protocol_t::XModem1K) {
+          // padded to the end of the last block
+          REQUIRE(received.size() == 4'224U);
+          CHECK(std::equal(image.begin(), image.end(), received.begin()));
+          CHECK(received.back() == std::byte{0x1a});
+        } else {
+          CHECK(received == image);
+          CHECK(got.name == "image.bin");
+        }
+      }
+      THEN("the progress is reported") {
+        REQUIRE_FALSE(positions.empty());
+        CHECK(std::ranges::is_sorted(positions));
+        CHECK(positions.back() == image.size());
+      }
+    }
+
+    WHEN("an interrupted ZMODEM transfer is resumed") {
+      auto received = std::vector<std::byte>{image.begin(),
+                                             image.begin() + 2'100};
+      const auto [sent, got] = transfer(
+          {.protocol = sp::transfer_protocol_t::ZModem, .timeout_ms = 2'000},
+          received);
+      THEN("only the rest of the file is sent") {
+        CHECK(sent.error == sp::transfer_error_t::None);
+        CHECK(got.error == sp::transfer_error_t::None);
+        CHECK(sent.offset == 2'100U);
+        CHECK(got.offset == 2'100U);
+        CHECK(sent.bytes == 2'100U);
+        CHECK(received == image);
+      }
+    }
+
+    WHEN("what the receiver has cannot be the beginning of the file") {
+      auto received = std::vector<std::byte>(5'000U);
+      const auto [sent, got] = transfer(
+          {.protocol = sp::transfer_protocol_t::ZModem, .timeout_ms = 2'000},
+          received);
+      THEN("the whole file is sent") {
+        CHECK(sent.offset == 0U);
+        CHECK(received == image);
+      }
+    }
+
+    WHEN("a file on disk is sent") {
+      const auto name =
+          "spp_bulk_transfer_" + std::to_string(::getpid()) + ".bin";
+      const auto path = std::filesystem::temp_directory_path() / name;
+      std::ofstream{path, std::ios::binary}.write(
+          reinterpret_cast<const char *>(image.data()),
+          static_cast<std::streamsize>(image.size()));
+      auto received = std::vector<std::byte>{};
+      const auto options = sp::transfer_options_t{.timeout_ms = 2'000};
+      auto receiver = std::async(std::launch::async, [&] {
+        return sp::receive(rx, received, options);
+      });
+      const auto sent = sp::send_file(tx, path.c_str(), options);
+      const auto got = receiver.get();
+      std::filesystem::remove(path);
+      THEN("it is sent from memory under its name") {
+        CHECK(sent.error == sp::transfer_error_t::None);
+        CHECK(got.name == name);
+        CHECK(received == image);
+      }
+    }
+
+    WHEN("a file that does not exist is sent") {
+      const auto sent = sp::send_file(tx, "/nonexistent/file", {});
+      THEN("an error is reported") {
+        CHECK(sent.error == sp::transfer_error_t::File);
+      }
+    }
+
+    WHEN("nobody receives") {
+      const auto sent = sp::send(
+          tx, image, "image.bin",
+          {.protocol = sp::transfer_protocol_t::XModem1K,
+           .timeout_ms = 20,
+           .max_retries = 2});
+      THEN("the sender gives up") {
+        CHECK(sent.error == sp::transfer_error_t::Timeout);
+      }
+    }
+  }
+
+  GIVEN("a sender and a receiver on a line that tampers with the data") {
+    auto near = sp_test::pty{};
+    auto far = sp_test::pty{};
+    const auto port_tx = sp::get_port_by_name("");
+    const auto port_rx = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port_tx, near.port());
+    sp_mock::set_native_handle(port_rx, far.port());
+    auto tx = sp::connection{port_tx, sp::mode_t::ReadWrite};
+    auto rx = sp::connection{port_rx, sp::mode_t::ReadWrite};
+
+    const auto transfer = [&](const sp::transfer_options_t &options,
+                              const sp::transfer_options_t &sender,
+                              std::vector<std::byte> &received,
+                              sp_test::link::filter_t to_receiver,
+                              sp_test::link::filter_t to_sender) {
+      const auto line = sp_test::link{near.device(), far.device(),
+                                      std::move(to_receiver),
+                                      std::move(to_sender)};
+      auto receiver = std::async(std::launch::async, [&] {
+        return sp::receive(rx, received, options);
+      });
+      auto sent = sp::send(tx, image, "image.bin", sender);
+      return std::pair{std::move(sent), receiver.get()};
+    };
+
+    WHEN("a byte of a file is corrupted on its way") {
+      const auto protocol =
+          GENERATE(sp::transfer_protocol_t::XModem1K,
+                   sp::transfer_protocol_t::YModem,
+                   sp::transfer_protocol_t::ZModem);
+      const auto options = sp::transfer_options_t{
+          .protocol = protocol, .timeout_ms = 2'000, .window = 2'048U};
+      auto received = std::vector<std::byte>{};
+      // in the middle of the second block, or a subpacket of ZMODEM
+      auto corrupt = [count = 0](std::string &chunk) mutable {
+        for (auto &c : chunk) {
+          if (++count == 2'000) {
+            c = static_cast<char>(c ^ 0x01);
+          }
+        }
+      };
+      const auto [sent, got] =
+          transfer(options, options, received, corrupt, {});
+      THEN("what has been corrupted is sent again") {
+        CHECK(sent.error == sp::transfer_error_t::None);
+        CHECK(got.error == sp::transfer_error_t::None);
+        CHECK(sent.bytes > image.size());
+        REQUIRE(received.size() >= image.size());
+        CHECK(std::equal(image.begin(), image.end(), received.begin()));
+      }
+    }
+
+    WHEN("the receiver's ZMODEM acknowledgements are lost") {
+      const auto options =
+          sp::transfer_options_t{.protocol = sp::transfer_protocol_t::ZModem,
+                                 .timeout_ms = 2'000,
+                                 .window = 2'048U};
+      // gives up on the window well before the receiver asks for more
+      auto sender = options;
+      sender.timeout_ms = 200;
+      auto received = std::vector<std::byte>{};
+      // hex headers end with CR and LF, the latter with its parity bit set
+      auto drop_acks = [pending = std::string{}](std::string &chunk) mutable {
+        pending += chunk;
+        chunk.clear();
+        for (auto end = pending.find('\x8a'); end != std::string::npos;
+             end = pending.find('\x8a')) {
+          const auto header = pending.substr(0U, end + 1U);
+          pending.erase(0U, end + 1U);
+          if (header.find("\x18" "B03") == std::string::npos) {
+            chunk += header;
+          }
+        }
+      };
+      const auto [sent, got] =
+          transfer(options, sender, received, {}, drop_acks);
+      THEN("the window is sent again") {
+        CHECK(sent.error == sp::transfer_error_t::None);
+        CHECK(got.error == sp::transfer_error_t::None);
+        CHECK(sent.bytes > image.size());
+        CHECK(received == image);
+      }
+    }
+  }
+}
+
+SCENARIO("the baud rate and framing are detected from the traffic") {
+  // devices send what they send, which appears as text only when the port
+  // is configured to match them, whereas pseudo terminals pass it on as is
+  const auto text = [] {
+    auto bytes = std::vector<std::byte>{};
+    for (const auto c : "T=21.5C\r\n"sv) {
+      bytes.push_back(std::byte(c));
+    }
+    bytes.resize(64U, std::byte{'.'});
+    return bytes;
+  }();
+  const auto garbage = [] {
+    auto bytes = std::vector<std::byte>(64U);
+    for (auto i = 0U; i < bytes.size(); ++i) {
+      bytes[i] = std::byte(static_cast<unsigned char>(0x80U + i % 0x40U));
+    }
+    return bytes;
+  }();
+  const auto matches = [](const sp::port_config_t &a,
+                          const sp::port_config_t &b) {
+    return a.baud_rate == b.baud_rate && a.bits == b.bits
+           && a.parity == b.parity;
+  };
+  // probes run on the threads of the sweep, where Catch2 must not be used
+  auto failed_writes = std::atomic<int>{0};
+  const auto send = [&failed_writes](const int fd,
+                                     const std::vector<std::byte> &bytes) {
+    if (::write(fd, bytes.data(), bytes.size())
+        != static_cast<ssize_t>(bytes.size())) {
+      ++failed_writes;
+    }
+  };
+  const auto device = [&](const int fd, const sp::port_config_t settings) {
+    return [&, fd, settings](sp::connection &, const sp::port_config_t &cfg) {
+      send(fd, matches(cfg, settings) ? text : garbage);
+    };
+  };
+  auto options = sp::autodetect_options_t{.baud_rates = {115'200, 9'600,
+                                                         57'600},
+                                          .sample_ms = 1'000,
+                                          .sample_bytes = 64U};
+
+  GIVEN("a device that talks at 9600 baud with 7E1") {
+    auto pty = sp_test::pty{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.device());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+    const auto settings = sp::port_config_t{.baud_rate = 9'600,
+                                            .bits = 7,
+                                            .stop_bits = 1,
+                                            .parity = sp::parity_t::Even};
+    options.probe = device(pty.port(), settings);
+
+    WHEN("its settings are detected") {
+      const auto result = sp::autodetect(conn, options);
+      THEN("the sweep stops at them and leaves them in effect") {
+        REQUIRE(result.status == sp::status_t::OK);
+        CHECK(matches(result.config, settings));
+        CHECK(result.score == 1.0);
+        // all framings at 115200 baud, then 8N1 and 7E1
+        CHECK(result.candidates == 7);
+        CHECK(matches(conn.get_config(), settings));
+        CHECK(failed_writes == 0);
+      }
+    }
+
+    WHEN("its protocol is binary and scored as such") {
+      options.content_score = [](const std::span<const std::byte> data) {
+        return data.size() > 2U && data[0] == std::byte{'T'}
+                       && data[1] == std::byte{'='}
+                   ? 1.0
+                   : 0.0;
+      };
+      const auto result = sp::autodetect(conn, options);
+      THEN("the content is scored by the protocol") {
+        CHECK(matches(result.config, settings));
+        CHECK(result.score == 1.0);
+        CHECK(failed_writes == 0);
+      }
+    }
+
+    WHEN("it does not talk at all") {
+      options.probe = {};
+      options.sample_ms = 5;
+      const auto before =
+          sp::port_config_t{19'200, 8, 1, sp::parity_t::None};
+      REQUIRE(conn.set_config(before) == sp::status_t::OK);
+      const auto result = sp::autodetect(conn, options);
+      THEN("every candidate is tried and the settings are left as they were") {
+        CHECK(result.score == 0.0);
+        CHECK(result.candidates == 15);
+        CHECK(matches(conn.get_config(), before));
+      }
+    }
+  }
+
+  GIVEN("a device whose bytes arrive with errors at other settings") {
+    // the marks that the driver inserts for parity and framing errors
+    const auto marked = [] {
+      auto bytes = std::vector<std::byte>{};
+      for (auto i = 0; i < 64; ++i) {
+        for (const auto c : "\377\0x"sv) {
+          bytes.push_back(std::byte(c));
+        }
+      }
+      return bytes;
+    }();
+    auto pty = sp_test::pty{};
+    const auto pipe = sp_test::pipe{};
+    const auto port = sp::get_port_by_name("");
+    sp_mock::set_native_handle(port, pty.device());
+    sp_mock::set_receive_handle(port, pipe.read_end());
+    auto conn = sp::connection{port, sp::mode_t::ReadWrite};
+    const auto settings = sp::port_config_t{.baud_rate = 57'600,
+                                            .bits = 8,
+                                            .stop_bits = 1,
+                                            .parity = sp::parity_t::None};
+    // what arrives at other settings is printable, but half of it in error
+    options.probe = [&](sp::connection &, const sp::port_config_t &cfg) {
+      send(pipe.write_end(), matches(cfg, settings) ? text : marked);
+    };
+
+    WHEN("its settings are detected") {
+      const auto result = sp::autodetect(conn, options);
+      THEN("the candidates with errors are passed over") {
+        REQUIRE(result.status == sp::status_t::OK);
+        CHECK(matches(result.config, settings));
+        CHECK(result.score == 1.0);
+        CHECK(failed_writes == 0);
+      }
+    }
+  }
 
+  GIVEN("several devices with different settings") {
+    const auto settings = std::array{
+        sp::port_config_t{9'600, 8, 1, sp::parity_t::None},
+        sp::port_config_t{57'600, 7, 1, sp::parity_t::Odd},
+        sp::port_config_t{115'200, 8, 1, sp::parity_t::Even},
+        sp::port_config_t{9'600, 7, 1, sp::parity_t::Even}};
+    auto ptys = std::vector<sp_test::pty>(settings.size());
+    auto conns = std::vector<sp::connection>{};
+    for (const auto &pty : ptys) {
+      const auto port = sp::get_port_by_name("");
+      sp_mock::set_native_handle(port, pty.device());
+      conns.emplace_back(port, sp::mode_t::ReadWrite);
+    }
+    options.probe = [&](sp::connection &conn, const sp::port_config_t &cfg) {
+      const auto i = static_cast<std::size_t>(&conn - conns.data());
+      device(ptys[i].port(), settings[i])(conn, cfg);
+    };
 
+    WHEN("they are detected concurrently") {
+      const auto results = sp::autodetect(conns, options, 2U);
+      THEN("each is detected on its own") {
+        REQUIRE(results.size() == settings.size());
+        for (auto i = 0U; i < results.size(); ++i) {
+          CHECK(results[i].status == sp::status_t::OK);
+          CHECK(matches(results[i].config, settings[i]));
+        }
+        CHECK(failed_writes == 0);
+      }
+    }
+  }
+}